@@ -14,6 +14,23 @@ VALUE_SIZE = 120
 
 NUM_INSERTIONS = 1000000
 NUM_OPERATIONS = 1000000
+NUM_RANGE_DELETES = 1000
+RANGE_DELETE_SELECTIVITY = 0.0001
+NUM_SCANS = 10000
+SCAN_SELECTIVITY = 0.001
+NUM_UPDATES = 500000
+
+# Lookups whose hot set moves: it jumps to a random place, drifts a little at a time, or its skew ramps up or cycles
+# like a day of traffic
+SHIFTING_WORKLOADS = {
+    'shift_jump': ['--ED_ZALPHA', '0.9', '--ED_SHIFT', str(NUM_OPERATIONS // 4)],
+    'shift_drift': ['--ED_ZALPHA', '0.9', '--ED_SHIFT', str(NUM_OPERATIONS // 40), '--ED_SHIFT_STEP', '0.001'],
+    'alpha_ramp': ['--ED_ZALPHA', '0.3', '--ED_ZALPHA_END', '1.2'],
+    'diurnal': ['--ED_ZALPHA', '0.3', '--ED_ZALPHA_END', '1.0', '--ED_ZALPHA_PERIOD', str(NUM_OPERATIONS // 2)],
+}
+
+# The same seed regenerates byte-identical workloads, with any number of generator threads
+SEED = 42
 
 WORKLOAD_PATH = 'workloads'
 
@@ -34,6 +51,7 @@ def generate_insertions(insertions_file: str, num_operations: int):
     """
 
     print()
+    random.seed(SEED)
     with open(insertions_file, 'w') as f:
         for _ in tqdm(range(num_operations), desc='Generating insertions', leave=False):
             key = random_string(KEY_SIZE)
@@ -47,16 +65,51 @@ def execute_workload_gen(output_file: str, args: list):
         os.makedirs(path)
 
     run_command = ['../bin/load_gen.exe', '--output-path', output_file, '-E', str(KEY_SIZE + VALUE_SIZE),
-                   '-L', f'{KEY_SIZE / (KEY_SIZE + VALUE_SIZE):.7f}'] + args
+                   '-L', f'{KEY_SIZE / (KEY_SIZE + VALUE_SIZE):.7f}', '--seed', str(SEED)] + args
 
     print()
+    output = ''
     with tqdm(total=100, desc=f'Generating {output_file}', leave=False) as pbar:
         with subprocess.Popen(run_command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, bufsize=1) as process:
             for char in iter(lambda: process.stdout.read(1), ''):
+                output += char
                 if char == '#':
                     pbar.update(1)
             process.wait()
 
+    if process.returncode != 0:
+        raise RuntimeError(f'load_gen failed to generate {output_file}:\n{output}')
+
+
+def convert_to_binary(workload: str) -> str:
+    """
+    Converts a text workload into the binary workload format (once) and returns the path of the binary file.
+
+    :param workload: The text workload to convert
+    :return: The path of the binary workload
+    """
+
+    binary_workload = os.path.splitext(workload)[0] + '.bin'
+    if not os.path.exists(binary_workload):
+        subprocess.run(['../bin/convert_workload', '-w', workload, '-o', binary_workload], check=True)
+    return binary_workload
+
+
+def import_trace(trace: str) -> str:
+    """
+    Imports a RocksDB query trace, or a block cache trace if its name ends in .block_cache_trace, into the binary
+    workload format (once) and returns the path of the binary file.
+
+    :param trace: The trace to import
+    :return: The path of the binary workload
+    """
+
+    binary_workload = trace + '.bin'
+    if not os.path.exists(binary_workload):
+        trace_flag = '-b' if trace.endswith('.block_cache_trace') else '-t'
+        subprocess.run(['../bin/import_trace', trace_flag, trace, '-o', binary_workload], check=True)
+    return binary_workload
+
 
 def generate_workloads():
     """Conditionally generates workloads"""
@@ -72,15 +125,39 @@ def generate_workloads():
 
     uniform_workload = f'{WORKLOAD_PATH}/uniform.txt'
     if not os.path.exists(uniform_workload):
-        execute_workload_gen(uniform_workload, ['--preloading', '--preload-filename', insertion_workload,
+        execute_workload_gen(uniform_workload, ['--streaming', '--preloading', '--preload-filename', insertion_workload,
                                                 '-Q', str(NUM_OPERATIONS), '--ED=3', '--ED_ZALPHA', '0.001'])
 
     for alpha in ZIPF_ALPHAS:
         workload = f'{WORKLOAD_PATH}/zipf_{alpha:.2f}.txt'
         if not os.path.exists(workload):
-            execute_workload_gen(workload, ['--preloading', '--preload-filename', insertion_workload,
+            execute_workload_gen(workload, ['--streaming', '--preloading', '--preload-filename', insertion_workload,
                                             '-Q', str(NUM_OPERATIONS), '--ED=3', '--ED_ZALPHA', str(alpha)])
 
+    range_delete_workload = f'{WORKLOAD_PATH}/range_deletes.txt'
+    if not os.path.exists(range_delete_workload):
+        execute_workload_gen(range_delete_workload, ['--preloading', '--preload-filename', insertion_workload,
+                                                     '-Q', str(NUM_OPERATIONS), '-R', str(NUM_RANGE_DELETES),
+                                                     '-y', str(RANGE_DELETE_SELECTIVITY), '--ED=3', '--ED_ZALPHA', '0.3'])
+
+    scan_workload = f'{WORKLOAD_PATH}/scans.txt'
+    if not os.path.exists(scan_workload):
+        execute_workload_gen(scan_workload, ['--streaming', '--preloading', '--preload-filename', insertion_workload,
+                                             '-Q', str(NUM_OPERATIONS), '-S', str(NUM_SCANS),
+                                             '-Y', str(SCAN_SELECTIVITY), '--ED=3', '--ED_ZALPHA', '0.3'])
+
+    update_workload = f'{WORKLOAD_PATH}/updates.txt'
+    if not os.path.exists(update_workload):
+        execute_workload_gen(update_workload, ['--streaming', '--preloading', '--preload-filename', insertion_workload,
+                                               '-Q', str(NUM_OPERATIONS), '-U', str(NUM_UPDATES),
+                                               '--ED=3', '--ED_ZALPHA', '0.3', '--UD=3', '--UD_ZALPHA', '0.3'])
+
+    for name, args in SHIFTING_WORKLOADS.items():
+        workload = f'{WORKLOAD_PATH}/{name}.txt'
+        if not os.path.exists(workload):
+            execute_workload_gen(workload, ['--streaming', '--preloading', '--preload-filename', insertion_workload,
+                                            '-Q', str(NUM_OPERATIONS), '--ED=3'] + args)
+
 
 if __name__ == '__main__':
     generate_workloads()
@@ -2,6 +2,8 @@ import os
 import json
 import matplotlib.pyplot as plt
 
+from results import level_hits
+
 directory = "experiment/experiment4_high_priority_ratios"
 
 flushed_or_similar_data = {}
@@ -16,7 +18,7 @@ for filename in os.listdir(directory):
         
         with open(os.path.join(directory, filename), "r") as f:
             content = json.load(f)
-            metric = sum(content.get("performance", {}).get("block_cache_hit_count", []))
+            metric = sum(level_hits(content))
             #metric = content.get("performance", {}).get("block_read_time", [])
         
         
@@ -3,6 +3,8 @@ import json
 import matplotlib.pyplot as plt
 import numpy as np
 
+from results import level_hits
+
 directory = "../experiment2_metadata_priority_matters"
 files = {
     "False": "high_priority-False.json",
@@ -14,7 +16,7 @@ block_cache_hit_counts = {}
 for priority, filename in files.items():
     with open(os.path.join(directory, filename), 'r') as file:
         data = json.load(file)
-        block_cache_hit_counts[priority] = data["performance"]["block_cache_hit_count"]
+        block_cache_hit_counts[priority] = level_hits(data)
 
 # get hitcounts for levels
 levels = [f"Level {i}" for i in range(1, len(block_cache_hit_counts["False"]) + 1)]
@@ -2,6 +2,8 @@ import os
 import json
 import matplotlib.pyplot as plt
 
+from results import level_hits
+
 directory = "../experiment3_pinning_policies/"
 results = {}
 
@@ -14,7 +16,7 @@ for filename in os.listdir(directory):
         try:
             with open(os.path.join(directory, filename), "r") as f:
                 content = json.load(f)
-                block_cache_hit_count = sum(content.get("performance", {}).get("block_cache_hit_count", []))
+                block_cache_hit_count = sum(level_hits(content))
                 if policy not in results:
                     results[policy] = []
                 results[policy].append((bb, block_cache_hit_count))
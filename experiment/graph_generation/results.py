@@ -0,0 +1,13 @@
+def level_hits(result: dict) -> list[int]:
+    """
+    Get the block cache hits of a run result by level, from the cache stats document the runner writes
+    (include/cache_stats.h). Results from before that document existed fall back to the scraped PerfContext text.
+
+    :param result: The run result, as loaded from its JSON file
+    :return: The hits of every level that had lookups, in level order
+    """
+
+    levels = result.get("cache", {}).get("levels", [])
+    if levels:
+        return [level["hits"] for level in sorted(levels, key=lambda level: level["level"])]
+    return result.get("performance", {}).get("block_cache_hit_count", [])
@@ -6,6 +6,8 @@ from matplotlib.colors import Normalize
 from collections import defaultdict
 import numpy as np
 
+from results import level_hits
+
 directory = "experiment/experiment1_skew_over_bb"
 results = defaultdict(lambda: defaultdict(float))
 
@@ -20,10 +22,9 @@ for filename in os.listdir(directory):
 
         with open(os.path.join(directory, filename), 'r') as file:
             data = json.load(file)
-            performance = data["performance"]
 
             # Sum block cache for levels
-            metric = sum(performance.get("block_cache_hit_count", []))
+            metric = sum(level_hits(data))
             results[skew][bb] = metric
 
 # Makes uniform the first key so that the keys line up with the results
@@ -1,15 +1,17 @@
+import glob
 import os
 import shutil
 
-from experiment.generate_workloads import NUM_INSERTIONS, KEY_SIZE, VALUE_SIZE, ZIPF_ALPHAS
-from experiment.run_workload import run_workload, run_workload_from_base
+from experiment.generate_workloads import NUM_INSERTIONS, KEY_SIZE, VALUE_SIZE, ZIPF_ALPHAS, SHIFTING_WORKLOADS, \
+    convert_to_binary, import_trace
+from experiment.run_workload import bulk_load, run_workload_from_base
 
 
 def generate_filled_db():
     workload = 'workloads/insertions.txt'
-    output_file = 'output/filled_db.json'
 
-    run_workload(workload, './filled_db', output_file, ['-T', '4'])
+    # The fill is pure insertions, so it is written as sorted SST files and ingested straight into the target levels
+    bulk_load(workload, './filled_db', ['-T', '4'])
 
 
 def run_tests():
@@ -26,6 +28,14 @@ def run_tests():
     high_priority_ratios = [0, 0.1, 0.3, 0.5, 0.7, 0.9]
     cache_metadata_options = [True, False]
     pinning_options = {'kNone': 1, 'kFlushedOrSimilar': 2, 'kAll': 3}
+    thread_counts = [1, 2, 4, 8, 16]
+    shard_bits_options = [0, 6]
+    multiget_batch_sizes = [1, 8, 32, 128]
+    cache_types = {'lru': 1, 'hyper_clock': 2, 'auto_hyper_clock': 3}
+    secondary_cache_ratios = [0, 0.25, 0.5]
+    ignore_range_deletions_options = [False, True]
+    scan_interference_runs = {'no_scans': ('zipf_0.30', [True]), 'scans': ('scans', [True, False])}
+    warmup_options = [False, True]
 
     # Experiment 1: We test different cache sizes against different levels of skew
     # Pinning is kNone. Priority ratio is 0.5. Metadata is cached with high priority.
@@ -96,6 +106,190 @@ def run_tests():
                                         '--cache_high_priority_ratio', str(int(choice)), '--cache_metadata_high_pri', '1'])
                 shutil.rmtree(db_path)
 
+    # Experiment 5: We test how throughput scales with the number of client threads, against a single cache shard
+    # and a sharded cache. Cache size is 0.2. Pinning is kNone. We use the binary zipf_0.30 workload.
+
+    experiment_path = 'experiment5_thread_scaling'
+    workload_path = convert_to_binary('workloads/zipf_0.30.txt')
+    for threads in thread_counts:
+        for shard_bits in shard_bits_options:
+            name = f'threads-{threads}_shard_bits-{shard_bits}'
+            db_path = f'{experiment_path}/{name}'
+            actual_size = int(total_size_mb * 0.2)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--threads', str(threads), '--shard_bits', str(shard_bits)])
+            shutil.rmtree(db_path)
+
+
+    # Experiment 6: We compare batched point lookups (MultiGet) against one-at-a-time lookups (batch size 1)
+    # for the subset of cache sizes. Pinning is kNone. We use the binary zipf_0.30 workload.
+
+    experiment_path = 'experiment6_multiget'
+    workload_path = convert_to_binary('workloads/zipf_0.30.txt')
+    for batch_size in multiget_batch_sizes:
+        for cache_size in subset_cache_sizes:
+            name = f'multiget-{batch_size}_bb-{cache_size}'
+            db_path = f'{experiment_path}/{name}'
+            actual_size = int(total_size_mb * cache_size)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--multiget', str(batch_size)])
+            shutil.rmtree(db_path)
+
+    # Experiment 7: We compare the block cache implementations for the subset of cache sizes, with a single client
+    # and with 8 clients contending for the cache. Pinning is kNone. We use the binary zipf_0.30 workload.
+
+    experiment_path = 'experiment7_cache_type'
+    workload_path = convert_to_binary('workloads/zipf_0.30.txt')
+    for cache_type in cache_types:
+        for threads in [1, 8]:
+            for cache_size in subset_cache_sizes:
+                name = f'{cache_type}_threads-{threads}_bb-{cache_size}'
+                db_path = f'{experiment_path}/{name}'
+                actual_size = int(total_size_mb * cache_size)
+                if os.path.exists(f'{experiment_path}/{name}.json'):
+                    continue
+                run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                       ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                        '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                        '--cache_type', str(cache_types[cache_type]), '--threads', str(threads)])
+                shutil.rmtree(db_path)
+
+    # Experiment 8: We split a fixed cache budget between the primary block cache and a compressed secondary cache
+    # for the subset of cache sizes. Pinning is kNone. We use the binary zipf_0.30 workload.
+
+    experiment_path = 'experiment8_secondary_cache'
+    workload_path = convert_to_binary('workloads/zipf_0.30.txt')
+    for secondary_ratio in secondary_cache_ratios:
+        for cache_size in subset_cache_sizes:
+            name = f'sec-{secondary_ratio}_bb-{cache_size}'
+            db_path = f'{experiment_path}/{name}'
+            budget = total_size_mb * cache_size
+            primary_size = int(budget * (1 - secondary_ratio))
+            secondary_size = int(budget * secondary_ratio)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(primary_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--sec_cache', str(secondary_size)])
+            shutil.rmtree(db_path)
+
+
+    # Experiment 9: We measure what range tombstones cost point lookups, by replaying a workload with range deletes
+    # with and without ignore_range_deletions, for the subset of cache sizes. Pinning is kNone.
+
+    experiment_path = 'experiment9_range_deletes'
+    workload_path = convert_to_binary('workloads/range_deletes.txt')
+    for ignore_range_deletions in ignore_range_deletions_options:
+        for cache_size in subset_cache_sizes:
+            name = f'ignore_range_deletions-{int(ignore_range_deletions)}_bb-{cache_size}'
+            db_path = f'{experiment_path}/{name}'
+            actual_size = int(total_size_mb * cache_size)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--ignore_range_deletions', str(int(ignore_range_deletions))])
+            shutil.rmtree(db_path)
+
+
+    # Experiment 10: We measure how much scans hurt the block cache hit rate of point lookups, by replaying the same
+    # zipf_0.30 lookups with and without interleaved scans, and with scans that do or do not fill the cache.
+    # Pinning is kNone.
+
+    experiment_path = 'experiment10_scan_interference'
+    for run_name, (workload, scan_fill_cache_options) in scan_interference_runs.items():
+        workload_path = convert_to_binary(f'workloads/{workload}.txt')
+        for scan_fill_cache in scan_fill_cache_options:
+            for cache_size in subset_cache_sizes:
+                name = f'{run_name}_scan_fill_cache-{int(scan_fill_cache)}_bb-{cache_size}'
+                db_path = f'{experiment_path}/{name}'
+                actual_size = int(total_size_mb * cache_size)
+                if os.path.exists(f'{experiment_path}/{name}.json'):
+                    continue
+                run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                       ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                        '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                        '--scan_fill_cache', str(int(scan_fill_cache))])
+                shutil.rmtree(db_path)
+
+
+    # Experiment 11: We measure how much warming up the block cache with the outputs of each compaction flattens the
+    # drop in hit rate and the Get latency spike after it, by replaying zipf_0.30 lookups mixed with updates with and
+    # without the warm-up. The .events.csv of each run has the hit rate and Get latency before and after every
+    # compaction, so the event timeline is turned on. Pinning is kNone.
+
+    experiment_path = 'experiment11_compaction_warmup'
+    workload_path = convert_to_binary('workloads/updates.txt')
+    for warmup in warmup_options:
+        for cache_size in subset_cache_sizes:
+            name = f'warmup-{int(warmup)}_bb-{cache_size}'
+            db_path = f'{experiment_path}/{name}'
+            actual_size = int(total_size_mb * cache_size)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--warmup', str(int(warmup)), '--event_window_ms', '1000'])
+            shutil.rmtree(db_path)
+
+
+    # Experiment 12: We measure how fast the block cache adapts when the hot set moves or its skew changes. The interval
+    # statistics of each run have the hit rate over time, which drops at every shift and recovers as the cache
+    # refills, so they are turned on. Pinning is kNone.
+
+    experiment_path = 'experiment12_shifting_hot_set'
+    for workload in SHIFTING_WORKLOADS:
+        workload_path = convert_to_binary(f'workloads/{workload}.txt')
+        for cache_size in subset_cache_sizes:
+            name = f'{workload}_bb-{cache_size}'
+            db_path = f'{experiment_path}/{name}'
+            actual_size = int(total_size_mb * cache_size)
+            if os.path.exists(f'{experiment_path}/{name}.json'):
+                continue
+            run_workload_from_base('filled_db', db_path, workload_path, f'{experiment_path}/{name}.json',
+                                   ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(pinning_options['kNone']),
+                                    '--cache_high_priority_ratio', '0.5', '--cache_metadata_high_pri', '1',
+                                    '--interval_stats', '1'])
+            shutil.rmtree(db_path)
+
+
+    # Experiment 13: We test the pinning policies and high priority ratios against traces captured on other nodes
+    # instead of zipf approximations. Every query trace (*.trace) and block cache trace (*.block_cache_trace) in traces/
+    # is replayed from traces/base_db, a checkpoint of the node taken when its traces started, or from filled_db if
+    # there is none. Metadata is cached with high priority.
+
+    experiment_path = 'experiment13_traces'
+    traces = sorted(glob.glob('traces/*.trace')) + sorted(glob.glob('traces/*.block_cache_trace'))
+    base_db = 'traces/base_db' if os.path.exists('traces/base_db') else 'filled_db'
+    base_size_mb = total_size_mb if base_db == 'filled_db' else \
+        sum(os.path.getsize(os.path.join(d, f)) for d, _, files in os.walk(base_db) for f in files) / 1024**2
+    for trace in traces:
+        workload_path = import_trace(trace)
+        trace_name = os.path.basename(trace).replace('.', '_')
+        for policy, choice in pinning_options.items():
+            for ratio in high_priority_ratios:
+                for cache_size in subset_cache_sizes:
+                    name = f'{trace_name}_pin-{policy}_high_pri-{ratio}_bb-{cache_size}'
+                    db_path = f'{experiment_path}/{name}'
+                    actual_size = int(base_size_mb * cache_size)
+                    if os.path.exists(f'{experiment_path}/{name}.json'):
+                        continue
+                    run_workload_from_base(base_db, db_path, workload_path, f'{experiment_path}/{name}.json',
+                                           ['-T', '4', '--bb', str(actual_size), '--metadata_pinning', str(choice),
+                                            '--cache_high_priority_ratio', str(ratio), '--cache_metadata_high_pri', '1'])
+                    shutil.rmtree(db_path)
+
 
 if __name__ == '__main__':
-    run_tests()
\ No newline at end of file
+    run_tests()
@@ -1,12 +1,28 @@
 import os
-import shutil
+import struct
 import subprocess
 
 import jsonpickle
 from tqdm import tqdm
 
 from experiment.generate_workloads import VALUE_SIZE, KEY_SIZE, PAGE_SIZE
-from experiment.statistics import parse_output, RocksDBStatistics
+from experiment.statistics import parse_output, parse_sidecar, remove_sidecar, RocksDBStatistics
+
+
+def count_operations(workload: str) -> int:
+    """
+    Count the operations in a workload file, in either the text or the binary format.
+
+    :param workload: The workload file.
+    :return: The number of operations.
+    """
+
+    with open(workload, 'rb') as f:
+        header = f.read(16)
+        if header[:4] == b'CPWL':
+            return struct.unpack('<Q', header[8:16])[0]
+        f.seek(0)
+        return sum(1 for _ in f)
 
 
 def run_workload(workload: str, path: str, output_file: str | None = None, additional_args: list | None = None, progress_bar: bool=True) -> RocksDBStatistics | None:
@@ -21,8 +37,7 @@ def run_workload(workload: str, path: str, output_file: str | None = None, addit
     :return: The parsed statistics or None if something went wrong.
     """
 
-    with open(workload, 'r') as f:
-        num_lines = len(f.readlines())
+    num_lines = count_operations(workload)
     num_logs = 100
     log_interval = num_lines // num_logs
 
@@ -57,6 +72,13 @@ def run_workload(workload: str, path: str, output_file: str | None = None, addit
         return None
 
     statistics = parse_output(output_file)
+    statistics.throughput = parse_sidecar(output_file, '.throughput.json')
+    statistics.latency = parse_sidecar(output_file, '.latency.json')
+    statistics.cache_tiers = parse_sidecar(output_file, '.cache_tiers.json')
+    statistics.range_deletions = parse_sidecar(output_file, '.range_deletions.json')
+    for suffix in ['.cache_stats.json', '.throughput.json', '.latency.json', '.cache_tiers.json',
+                   '.range_deletions.json']:
+        remove_sidecar(output_file, suffix)
     os.remove(output_file)
     if output_file is not None:
         with open(output_file, 'w') as f:
@@ -67,12 +89,37 @@ def run_workload(workload: str, path: str, output_file: str | None = None, addit
     return statistics
 
 
+def bulk_load(workload: str, path: str, additional_args: list | None = None) -> bool:
+    """
+    Build a database from the inserts of a workload by writing and ingesting SST files, instead of replaying them.
+
+    :param workload: The workload file whose inserts to load.
+    :param path: The path for the database.
+    :param additional_args: Additional arguments to pass to the workload running program.
+    :return: Whether the database was built.
+    """
+
+    run_command = ['../bin/working_version', '--path', path, '-w', workload, '--bulk_load', '1',
+                   '-E', str(VALUE_SIZE + KEY_SIZE),
+                   '-B', str(round(PAGE_SIZE / (PAGE_SIZE + VALUE_SIZE)))] + (additional_args if additional_args else [])
+
+    print(f'\nBulk loading {workload} into {path}')
+    process = subprocess.run(run_command, capture_output=True, text=True)
+    print(process.stdout)
+    if process.returncode != 0:
+        print(f'Error bulk loading workload: {process.stderr}')
+        return False
+
+    return True
+
+
 def run_workload_from_base(base_db: str, new_path: str, workload: str, output_file: str | None = None, additional_args: list | None = None, progress_bar: bool=True) -> RocksDBStatistics:
     """
-    Run a workload on a copy of a base database and returns the parsed statistics.
+    Run a workload on a clone of a base database and returns the parsed statistics.
+    The runner hard links the SST files of the base database instead of copying them.
 
-    :param base_db: The base database to copy.
-    :param new_path: The path to copy the base database to.
+    :param base_db: The base database to clone.
+    :param new_path: The path to clone the base database to.
     :param workload: The workload file to run.
     :param output_file: The file to write the statistics to (if not None).
     :param additional_args: Additional arguments to pass to the workload running program.
@@ -80,8 +127,5 @@ def run_workload_from_base(base_db: str, new_path: str, workload: str, output_fi
     :return: The parsed statistics.
     """
 
-    if os.path.exists(new_path):
-        shutil.rmtree(new_path)
-    shutil.copytree(base_db, new_path)
-
-    return run_workload(workload, new_path, output_file, ['-d', '0'] + additional_args if additional_args else [], progress_bar)
\ No newline at end of file
+    return run_workload(workload, new_path, output_file,
+                        ['--from_checkpoint', base_db] + (additional_args if additional_args else []), progress_bar)
\ No newline at end of file
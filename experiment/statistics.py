@@ -1,3 +1,6 @@
+import json
+import os
+
 # Alias for readability
 type LevelByLevelStat = list[int]
 
@@ -20,11 +23,17 @@ class RocksDBStatistics:
         self.io: dict[str, int] = {}
         self.count_stats: dict[str, int] = {}
         self.aggregate_stats: dict[str, AggregateStat] = {}
+        self.cache: dict = {}
+        self.throughput: dict = {}
+        self.latency: dict = {}
+        self.cache_tiers: dict = {}
+        self.range_deletions: dict = {}
 
 
 def parse_output(output_file) -> RocksDBStatistics:
     """
-    Parse the output file from RocksDB and return the statistics.
+    Parse the output file from RocksDB and return the statistics. The block cache hits and misses by level come from
+    the cache stats document of the run (see parse_cache_stats) when it wrote one, rather than the PerfContext text.
 
     :param output_file: The output file to parse
     :return: The parsed statistics
@@ -79,4 +88,83 @@ def parse_output(output_file) -> RocksDBStatistics:
             stat.sum = int(line_parts[18])
             statistics.aggregate_stats[key] = stat
 
+    statistics.cache = parse_cache_stats(output_file)
+    levels = sorted(statistics.cache.get('levels', []), key=lambda level: level['level'])
+    if levels:
+        statistics.performance['block_cache_hit_count'] = [level['hits'] for level in levels]
+        statistics.performance['block_cache_miss_count'] = [level['misses'] for level in levels]
+
     return statistics
+
+
+def parse_sidecar(output_file, suffix: str) -> dict:
+    """
+    Load a JSON document the runner writes next to the output file.
+
+    :param output_file: The output file of the run
+    :param suffix: The suffix that replaces the extension of the output file, e.g. '.cache_stats.json'
+    :return: The parsed document, or an empty dict if the run did not write it
+    """
+
+    sidecar_file = os.path.splitext(output_file)[0] + suffix
+    if not os.path.exists(sidecar_file):
+        return {}
+
+    with open(sidecar_file, 'r') as f:
+        return json.load(f)
+
+
+def remove_sidecar(output_file, suffix: str):
+    """
+    Delete a JSON document the runner wrote next to the output file, once it is folded into the result. The graph
+    scripts take every .json file of a result directory for a result.
+
+    :param output_file: The output file of the run
+    :param suffix: The suffix that replaces the extension of the output file
+    """
+
+    sidecar_file = os.path.splitext(output_file)[0] + suffix
+    if os.path.exists(sidecar_file):
+        os.remove(sidecar_file)
+
+
+def parse_cache_stats(output_file) -> dict:
+    """
+    Load the block cache counters the runner writes next to the output file, by block type and by level.
+    See include/cache_stats.h for the schema.
+
+    :param output_file: The output file of the run
+    :return: The parsed counters, or an empty dict if the run did not write them
+    """
+
+    return parse_sidecar(output_file, '.cache_stats.json')
+
+
+def parse_events(output_file) -> list[dict]:
+    """
+    Load the flush and compaction timeline the runner writes next to the output file, one dict per event with
+    the block cache hit rate before and after it. See include/event_timeline.h for the columns.
+
+    :param output_file: The output file of the run
+    :return: The parsed events, or an empty list if the run did not write them
+    """
+
+    events_file = os.path.splitext(output_file)[0] + '.events.csv'
+    if not os.path.exists(events_file):
+        return []
+
+    with open(events_file, 'r') as f:
+        header = f.readline().strip().split(',')
+        events = []
+        for line in f:
+            values = line.strip().split(',')
+            event = {}
+            for key, value in zip(header, values):
+                if key == 'type':
+                    event[key] = value
+                elif '.' in value or 'e' in value:
+                    event[key] = float(value)
+                else:
+                    event[key] = int(value)
+            events.append(event)
+        return events
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <rocksdb/db.h>
+#include <rocksdb/sst_file_writer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ASSERT_message.h"
+#include "config_options.h"
+#include "workload_file.h"
+
+/**
+ * Builds a database straight from the insertions of a workload, without going through the memtable, WAL and
+ * compactions: the final state of every key is sorted, written into SST files with SstFileWriter and ingested with
+ * IngestExternalFile. The key-value pairs are spread over the levels of a leveled LSM in proportion to the level
+ * capacities implied by GetBufferSize() and size_ratio, using a fixed hash of the key, so the same workload and
+ * options always produce the same tree.
+ */
+namespace BulkLoad {
+
+  /** FNV-1a, which unlike std::hash is the same on every platform and build */
+  inline uint64_t HashKey(const std::string& key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : key) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  /** The last write of every key that still exists at the end of the workload, in key order */
+  inline std::vector<std::pair<std::string, std::string>> ReadFinalState(const std::string& workload_path) {
+    struct Write {
+      std::string key;
+      std::string value;
+      bool deleted;
+    };
+
+    std::vector<Write> writes;
+    const std::unique_ptr<WorkloadReader> workload = OpenWorkload(workload_path);
+    WorkloadOp op;
+    uint64_t num_skipped = 0;
+    while (workload->Next(op)) {
+      if (op.instruction == 'I' || op.instruction == 'U' || op.instruction == 'D') {
+        writes.push_back({op.key.ToString(), op.value.ToString(), op.instruction == 'D'});
+      } else {
+        num_skipped++;
+      }
+    }
+    if (num_skipped > 0)
+      std::cout << "Bulk load ignores reads and range deletes, skipped " << num_skipped << " instructions" << std::endl;
+
+    // Stable, so the last write of a key comes last among its equals
+    std::stable_sort(writes.begin(), writes.end(), [](const Write& a, const Write& b) { return a.key < b.key; });
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    for (size_t i = 0; i < writes.size(); i++) {
+      if (i + 1 < writes.size() && writes[i + 1].key == writes[i].key)
+        continue;
+      if (!writes[i].deleted)
+        entries.emplace_back(std::move(writes[i].key), std::move(writes[i].value));
+    }
+    return entries;
+  }
+
+  /** The byte capacity of levels 1..n, with as many levels as needed to hold total_bytes */
+  inline std::vector<double> LevelCapacities(const DBEnv& env, const uint64_t total_bytes) {
+    std::vector<double> capacities;
+    double capacity = env.GetMaxBytesForLevelBase();
+    double sum = 0;
+    do {
+      capacities.push_back(capacity);
+      sum += capacity;
+      capacity *= env.size_ratio;
+    } while (sum < total_bytes);
+    return capacities;
+  }
+
+  /** Writes the given entries into SST files of about target_file_size bytes each, returning their paths */
+  inline std::vector<std::string> WriteFiles(const Options& options, const std::string& dir, const int level,
+    const std::vector<std::pair<std::string, std::string>>& entries, const std::vector<size_t>& indices) {
+    std::vector<std::string> files;
+    SstFileWriter writer(EnvOptions(), options);
+    bool open = false;
+
+    for (const size_t i : indices) {
+      if (!open) {
+        files.push_back(dir + "/L" + std::to_string(level) + "_" + std::to_string(files.size()) + ".sst");
+        const Status s = writer.Open(files.back());
+        ASSERT(s.ok(), s.ToString());
+        open = true;
+      }
+
+      const Status s = writer.Put(entries[i].first, entries[i].second);
+      ASSERT(s.ok(), s.ToString());
+
+      if (writer.FileSize() >= options.target_file_size_base) {
+        const Status finish = writer.Finish();
+        ASSERT(finish.ok(), finish.ToString());
+        open = false;
+      }
+    }
+
+    if (open) {
+      const Status s = writer.Finish();
+      ASSERT(s.ok(), s.ToString());
+    }
+    return files;
+  }
+}  // namespace BulkLoad
+
+/** Loads the final state of the workload into the database at env.db_path. */
+inline bool BulkLoadWorkload(const DBEnv& env) {
+  Options options;
+  BlockBasedTableOptions table_options;
+
+  configureOptions(env, options);
+  configureTableOptions(env, table_options);
+
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+
+  if (env.destroy_database) {
+    std::cout << "Destroying database..." << std::endl;
+    DestroyDB(env.db_path, options);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  const auto entries = BulkLoad::ReadFinalState(env.workload_file_path);
+  const uint64_t total_bytes = std::accumulate(entries.begin(), entries.end(), uint64_t{0},
+    [](const uint64_t sum, const auto& entry) { return sum + entry.first.size() + entry.second.size(); });
+
+  const std::vector<double> capacities = BulkLoad::LevelCapacities(env, total_bytes);
+  const int num_levels = static_cast<int>(capacities.size());
+  ASSERT(num_levels < env.num_levels, "The workload needs " + std::to_string(num_levels) + " levels, but only "
+    + std::to_string(env.num_levels - 1) + " are configured");
+
+  // Every level gets the same share of its capacity, so no level starts out over its compaction target
+  std::vector<double> thresholds;
+  const double total_capacity = std::accumulate(capacities.begin(), capacities.end(), 0.0);
+  double cumulative = 0;
+  for (const double capacity : capacities) {
+    cumulative += capacity;
+    thresholds.push_back(cumulative / total_capacity);
+  }
+
+  std::vector<std::vector<size_t>> level_indices(num_levels);
+  for (size_t i = 0; i < entries.size(); i++) {
+    const double position = static_cast<double>(BulkLoad::HashKey(entries[i].first) >> 11) / (uint64_t{1} << 53);
+    const auto level = std::upper_bound(thresholds.begin(), thresholds.end(), position) - thresholds.begin();
+    level_indices[std::min<size_t>(level, num_levels - 1)].push_back(i);
+  }
+
+  // Ingestion places a file on the deepest level that has no overlapping data above it, so with the last level
+  // being num_levels the levels are filled bottom up and every one of them lands where it belongs
+  options.num_levels = num_levels + 1;
+
+  DB* db;
+  Status s = DB::Open(options, env.db_path, &db);
+  ASSERT(s.ok(), s.ToString());
+
+  const std::string sst_dir = env.db_path + "_bulk_load";
+  std::filesystem::remove_all(sst_dir);
+  std::filesystem::create_directories(sst_dir);
+
+  IngestExternalFileOptions ingest_options;
+  ingest_options.move_files = true;
+  for (int level = num_levels; level >= 1; level--) {
+    const auto& indices = level_indices[level - 1];
+    if (indices.empty())
+      continue;
+
+    const std::vector<std::string> files = BulkLoad::WriteFiles(options, sst_dir, level, entries, indices);
+    s = db->IngestExternalFile(files, ingest_options);
+    ASSERT(s.ok(), s.ToString());
+    std::cout << "Level " << level << ": " << indices.size() << " entries in " << files.size() << " files" << std::endl;
+  }
+
+  std::string level_stats;
+  db->GetProperty(DB::Properties::kLevelStats, &level_stats);
+  std::cout << level_stats << std::endl;
+
+  s = db->Close();
+  ASSERT(s.ok(), s.ToString());
+  delete db;
+  std::filesystem::remove_all(sst_dir);
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Bulk loaded " << entries.size() << " entries (" << total_bytes << " bytes) into " << num_levels
+    << " levels in " << seconds << " s" << std::endl;
+
+  return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <rocksdb/cache.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/** What the block cache held at one point in time, in bytes charged to the cache */
+struct CacheOccupancy {
+  uint64_t usage = 0;
+  uint64_t pinned_usage = 0;
+  uint64_t entries = 0;
+  uint64_t data_bytes = 0;
+  uint64_t index_bytes = 0;
+  /** Full and partitioned filters, including the top level of partitioned filters */
+  uint64_t filter_bytes = 0;
+  uint64_t other_bytes = 0;
+  /**
+   * Derived, not measured: the index and filter bytes when they go to the high priority pool of an LRU cache, and 0
+   * for caches without priority pools
+   */
+  uint64_t high_priority_bytes = 0;
+};
+
+/**
+ * Walks the block cache with Cache::ApplyToAllEntries on a background thread, so the clients never wait on it,
+ * and keeps the latest sample around for the interval statistics.
+ *
+ * The cache only knows an entry's role, not the file or level it came from, so occupancy is broken down by role.
+ * RocksDB does not expose the pool an entry sits in either: index and filter blocks are inserted with high priority
+ * exactly when metadata is cached with high priority, so their bytes stand in for the high priority pool. Only
+ * LRUCache with a non-zero high priority ratio has that pool; HyperClockCache ignores priorities.
+ */
+class CacheOccupancySampler {
+public:
+  CacheOccupancySampler(std::shared_ptr<rocksdb::Cache> cache, const std::chrono::milliseconds period,
+    const bool metadata_in_high_priority_pool) :
+    cache_(std::move(cache)), period_(period), metadata_in_high_priority_pool_(metadata_in_high_priority_pool) {
+    latest_ = Sample();
+    thread_ = std::thread([this] { Run(); });
+  }
+
+  ~CacheOccupancySampler() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  CacheOccupancySampler(const CacheOccupancySampler&) = delete;
+  CacheOccupancySampler& operator=(const CacheOccupancySampler&) = delete;
+
+  [[nodiscard]] CacheOccupancy Latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+  }
+
+private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, period_, [this] { return stop_; })) {
+      lock.unlock();
+      const CacheOccupancy sample = Sample();
+      lock.lock();
+      latest_ = sample;
+    }
+  }
+
+  [[nodiscard]] CacheOccupancy Sample() const {
+    CacheOccupancy sample;
+    sample.usage = cache_->GetUsage();
+    sample.pinned_usage = cache_->GetPinnedUsage();
+
+    cache_->ApplyToAllEntries(
+      [&sample](const rocksdb::Slice&, rocksdb::Cache::ObjectPtr, const size_t charge,
+        const rocksdb::Cache::CacheItemHelper *helper) {
+        sample.entries++;
+        switch (helper != nullptr ? helper->role : rocksdb::CacheEntryRole::kMisc) {
+          case rocksdb::CacheEntryRole::kDataBlock:
+            sample.data_bytes += charge;
+            break;
+          case rocksdb::CacheEntryRole::kIndexBlock:
+            sample.index_bytes += charge;
+            break;
+          case rocksdb::CacheEntryRole::kFilterBlock:
+          case rocksdb::CacheEntryRole::kFilterMetaBlock:
+          case rocksdb::CacheEntryRole::kDeprecatedFilterBlock:
+            sample.filter_bytes += charge;
+            break;
+          default:
+            sample.other_bytes += charge;
+            break;
+        }
+      },
+      rocksdb::Cache::ApplyToAllEntriesOptions());
+
+    if (metadata_in_high_priority_pool_)
+      sample.high_priority_bytes = sample.index_bytes + sample.filter_bytes;
+    return sample;
+  }
+
+  std::shared_ptr<rocksdb::Cache> cache_;
+  std::chrono::milliseconds period_;
+  bool metadata_in_high_priority_pool_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  CacheOccupancy latest_;
+  std::thread thread_;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <rocksdb/perf_context.h>
+#include <rocksdb/statistics.h>
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "ASSERT_message.h"
+
+/** The block cache counters RocksDB keeps for one level of the LSM, from the per-level perf context */
+struct LevelCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t bloom_filter_useful = 0;
+  uint64_t bloom_filter_full_positive = 0;
+  uint64_t bloom_filter_full_true_positive = 0;
+  uint64_t user_key_return_count = 0;
+
+  void Merge(const LevelCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    bloom_filter_useful += other.bloom_filter_useful;
+    bloom_filter_full_positive += other.bloom_filter_full_positive;
+    bloom_filter_full_true_positive += other.bloom_filter_full_true_positive;
+    user_key_return_count += other.user_key_return_count;
+  }
+};
+
+using LevelCacheStatsMap = std::map<uint32_t, LevelCacheStats>;
+
+/**
+ * Copies the per-level perf context of the calling thread, which is gone once the thread exits.
+ * Empty unless EnablePerLevelPerfContext was called on the thread.
+ */
+inline LevelCacheStatsMap CaptureLevelCacheStats() {
+  LevelCacheStatsMap levels;
+  const auto *level_to_perf_context = rocksdb::get_perf_context()->level_to_perf_context;
+  if (level_to_perf_context == nullptr)
+    return levels;
+
+  for (const auto& [level, perf] : *level_to_perf_context) {
+    LevelCacheStats& stats = levels[level];
+    stats.hits = perf.block_cache_hit_count;
+    stats.misses = perf.block_cache_miss_count;
+    stats.bloom_filter_useful = perf.bloom_filter_useful;
+    stats.bloom_filter_full_positive = perf.bloom_filter_full_positive;
+    stats.bloom_filter_full_true_positive = perf.bloom_filter_full_true_positive;
+    stats.user_key_return_count = perf.user_key_return_count;
+  }
+  return levels;
+}
+
+/**
+ * Writes the block cache counters as JSON, by block type from the statistics tickers and by level from the
+ * per-level perf context. RocksDB only counts bytes per block type, so levels carry hits and misses only.
+ *
+ * The schema is versioned, fields are only ever added:
+ *
+ *   {"schema_version": 1,
+ *    "total": {"hits", "misses", "adds", "add_failures", "bytes_read", "bytes_written"},
+ *    "block_types": {"data" | "index" | "filter" | "compression_dict": {"hits", "misses", "adds", "bytes_inserted"}},
+ *    "levels": [{"level", "hits", "misses", "bloom_filter_useful", "bloom_filter_full_positive",
+ *                "bloom_filter_full_true_positive", "user_key_return_count"}]}
+ */
+inline void WriteCacheStats(const std::string& path, const std::shared_ptr<rocksdb::Statistics>& statistics,
+  const LevelCacheStatsMap& levels) {
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  ASSERT(file.is_open(), "Failed to open output file " + path);
+
+  const auto ticker = [&statistics](const uint32_t ticker) { return statistics->getTickerCount(ticker); };
+  const auto write_block_type = [&](const char *name, const uint32_t hits, const uint32_t misses, const uint32_t adds,
+    const uint32_t bytes_inserted) {
+    file << "\"" << name << "\": {\"hits\": " << ticker(hits)
+      << ", \"misses\": " << ticker(misses)
+      << ", \"adds\": " << ticker(adds)
+      << ", \"bytes_inserted\": " << ticker(bytes_inserted) << "}";
+  };
+
+  file << "{\"schema_version\": 1"
+    << ", \"total\": {\"hits\": " << ticker(rocksdb::BLOCK_CACHE_HIT)
+    << ", \"misses\": " << ticker(rocksdb::BLOCK_CACHE_MISS)
+    << ", \"adds\": " << ticker(rocksdb::BLOCK_CACHE_ADD)
+    << ", \"add_failures\": " << ticker(rocksdb::BLOCK_CACHE_ADD_FAILURES)
+    << ", \"bytes_read\": " << ticker(rocksdb::BLOCK_CACHE_BYTES_READ)
+    << ", \"bytes_written\": " << ticker(rocksdb::BLOCK_CACHE_BYTES_WRITE) << "}";
+
+  file << ", \"block_types\": {";
+  write_block_type("data", rocksdb::BLOCK_CACHE_DATA_HIT, rocksdb::BLOCK_CACHE_DATA_MISS,
+    rocksdb::BLOCK_CACHE_DATA_ADD, rocksdb::BLOCK_CACHE_DATA_BYTES_INSERT);
+  file << ", ";
+  write_block_type("index", rocksdb::BLOCK_CACHE_INDEX_HIT, rocksdb::BLOCK_CACHE_INDEX_MISS,
+    rocksdb::BLOCK_CACHE_INDEX_ADD, rocksdb::BLOCK_CACHE_INDEX_BYTES_INSERT);
+  file << ", ";
+  write_block_type("filter", rocksdb::BLOCK_CACHE_FILTER_HIT, rocksdb::BLOCK_CACHE_FILTER_MISS,
+    rocksdb::BLOCK_CACHE_FILTER_ADD, rocksdb::BLOCK_CACHE_FILTER_BYTES_INSERT);
+  file << ", ";
+  write_block_type("compression_dict", rocksdb::BLOCK_CACHE_COMPRESSION_DICT_HIT,
+    rocksdb::BLOCK_CACHE_COMPRESSION_DICT_MISS, rocksdb::BLOCK_CACHE_COMPRESSION_DICT_ADD,
+    rocksdb::BLOCK_CACHE_COMPRESSION_DICT_BYTES_INSERT);
+  file << "}";
+
+  file << ", \"levels\": [";
+  bool first = true;
+  for (const auto& [level, stats] : levels) {
+    file << (first ? "" : ", ") << "{\"level\": " << level
+      << ", \"hits\": " << stats.hits
+      << ", \"misses\": " << stats.misses
+      << ", \"bloom_filter_useful\": " << stats.bloom_filter_useful
+      << ", \"bloom_filter_full_positive\": " << stats.bloom_filter_full_positive
+      << ", \"bloom_filter_full_true_positive\": " << stats.bloom_filter_full_true_positive
+      << ", \"user_key_return_count\": " << stats.user_key_return_count << "}";
+    first = false;
+  }
+  file << "]}" << std::endl;
+}
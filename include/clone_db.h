@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include "ASSERT_message.h"
+
+/**
+ * Creates a working copy of a closed base database, the same way RocksDB's Checkpoint does for an open one:
+ * table and blob files are immutable once written, so they are hard linked and shared with the base, while the
+ * files RocksDB appends to (MANIFEST, WAL, ...) are copied. Files whose hard link fails, e.g. because the two
+ * directories are on different file systems, fall back to a copy.
+ */
+inline void CloneDatabase(const std::string& base_path, const std::string& db_path) {
+  namespace fs = std::filesystem;
+  ASSERT(fs::is_directory(base_path), "Base database " + base_path + " does not exist");
+
+  const auto start = std::chrono::steady_clock::now();
+  fs::remove_all(db_path);
+  fs::create_directories(db_path);
+
+  int num_linked = 0, num_copied = 0;
+  for (const auto& entry : fs::directory_iterator(base_path)) {
+    if (!entry.is_regular_file())
+      continue;
+
+    const std::string name = entry.path().filename().string();
+    // The lock is taken by whoever opens the copy, and info logs are not part of the database
+    if (name == "LOCK" || name.rfind("LOG", 0) == 0)
+      continue;
+
+    const fs::path target = fs::path(db_path) / name;
+    const std::string extension = entry.path().extension().string();
+    if (extension == ".sst" || extension == ".blob") {
+      std::error_code error;
+      fs::create_hard_link(entry.path(), target, error);
+      if (!error) {
+        num_linked++;
+        continue;
+      }
+    }
+
+    fs::copy_file(entry.path(), target, fs::copy_options::overwrite_existing);
+    num_copied++;
+  }
+
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Cloned " << base_path << " into " << db_path << " in " << seconds << " s (" << num_linked
+    << " files linked, " << num_copied << " copied)" << std::endl;
+}
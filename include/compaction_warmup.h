@@ -0,0 +1,183 @@
+#pragma once
+
+#include <rocksdb/iostats_context.h>
+#include <rocksdb/listener.h>
+#include <rocksdb/options.h>
+#include <rocksdb/sst_file_reader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** What the warm-up read, over all the compactions of a run */
+struct WarmupStats {
+  uint64_t compactions = 0;
+  uint64_t files = 0;
+  /** Output files that were gone or could not be opened, e.g. because a later compaction already removed them */
+  uint64_t failed_files = 0;
+  /** Compactions whose warm-up stopped early because it used up its IO budget */
+  uint64_t budget_exhausted = 0;
+  uint64_t metadata_bytes = 0;
+  uint64_t hot_keys = 0;
+  uint64_t data_bytes = 0;
+  double seconds = 0;
+};
+
+/**
+ * Reads the blocks of the files a compaction created into the block cache on a background thread, so the lookups that
+ * hit the compacted key range do not all miss at once after the old files are dropped from the cache.
+ *
+ * Every output file is opened with an SstFileReader that shares the DB's table factory, and thus its block cache.
+ * Block cache keys derive from the unique id in the table properties rather than from the reader, so the blocks it
+ * loads are the ones the DB looks up. Opening the file prefetches its index and filter blocks into the cache (with
+ * cache_index_and_filter_blocks; otherwise the DB's own table reader holds them and this step only costs the IO).
+ * With hot keys enabled, the data blocks of a sample of the recently looked up keys follow, in key order.
+ *
+ * The IO budget caps the bytes read per compaction, measured with the warm-up thread's iostats context.
+ */
+class CompactionWarmer {
+public:
+  /** One in this many point lookups is sampled as a hot key */
+  static constexpr uint64_t kLookupSampling = 64;
+
+  CompactionWarmer(const rocksdb::Options& options, const uint64_t budget_bytes, const size_t num_hot_keys) :
+    options_(options), budget_bytes_(budget_bytes), hot_keys_(num_hot_keys) {
+    // The warm-up stays out of the run's statistics, so hit rates only count the workload's reads
+    options_.statistics = nullptr;
+    options_.listeners.clear();
+    thread_ = std::thread([this] { Run(); });
+  }
+
+  ~CompactionWarmer() { Stop(); }
+
+  CompactionWarmer(const CompactionWarmer&) = delete;
+  CompactionWarmer& operator=(const CompactionWarmer&) = delete;
+
+  /** Adds a looked up key to the hot keys, replacing the oldest one */
+  void RecordLookup(const rocksdb::Slice& key) {
+    if (hot_keys_.empty())
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    hot_keys_[next_hot_key_++ % hot_keys_.size()].assign(key.data(), key.size());
+  }
+
+  void OnCompactionCompleted(const rocksdb::CompactionJobInfo& info) {
+    if (!info.status.ok() || info.output_files.empty())
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(info.output_files);
+    }
+    cv_.notify_one();
+  }
+
+  /** Stops the warm-up, dropping the compactions that were not warmed up yet */
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  [[nodiscard]] WarmupStats Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (stop_)
+        break;
+
+      const std::vector<std::string> files = std::move(pending_.front());
+      pending_.pop_front();
+      std::vector<std::string> hot_keys(hot_keys_.begin(), hot_keys_.begin() + std::min(next_hot_key_,
+        static_cast<uint64_t>(hot_keys_.size())));
+      lock.unlock();
+
+      std::sort(hot_keys.begin(), hot_keys.end());
+      hot_keys.erase(std::unique(hot_keys.begin(), hot_keys.end()), hot_keys.end());
+      const WarmupStats stats = Warm(files, hot_keys);
+
+      lock.lock();
+      stats_.compactions++;
+      stats_.files += stats.files;
+      stats_.failed_files += stats.failed_files;
+      stats_.budget_exhausted += stats.budget_exhausted;
+      stats_.metadata_bytes += stats.metadata_bytes;
+      stats_.hot_keys += stats.hot_keys;
+      stats_.data_bytes += stats.data_bytes;
+      stats_.seconds += stats.seconds;
+    }
+  }
+
+  /** Warms up the output files of one compaction, the metadata of all of them before any data */
+  WarmupStats Warm(const std::vector<std::string>& files, const std::vector<std::string>& hot_keys) {
+    WarmupStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t bytes_start = rocksdb::get_iostats_context()->bytes_read;
+    const auto bytes_read = [bytes_start] { return rocksdb::get_iostats_context()->bytes_read - bytes_start; };
+
+    std::vector<std::unique_ptr<rocksdb::SstFileReader>> readers;
+    for (const auto& file : files) {
+      if (budget_bytes_ > 0 && bytes_read() >= budget_bytes_) {
+        stats.budget_exhausted = 1;
+        break;
+      }
+      auto reader = std::make_unique<rocksdb::SstFileReader>(options_);
+      if (!reader->Open(file).ok()) {
+        stats.failed_files++;
+        continue;
+      }
+      stats.files++;
+      readers.push_back(std::move(reader));
+    }
+    stats.metadata_bytes = bytes_read();
+
+    rocksdb::ReadOptions read_options;
+    read_options.fill_cache = true;
+    for (auto& reader : readers) {
+      if (hot_keys.empty() || stats.budget_exhausted)
+        break;
+
+      // Keys past the end of the file leave the iterator invalid, the keys within it load the blocks holding them
+      std::unique_ptr<rocksdb::Iterator> it(reader->NewIterator(read_options));
+      for (const auto& key : hot_keys) {
+        if (budget_bytes_ > 0 && bytes_read() >= budget_bytes_) {
+          stats.budget_exhausted = 1;
+          break;
+        }
+        it->Seek(key);
+        stats.hot_keys += it->Valid() && it->key() == rocksdb::Slice(key);
+      }
+    }
+    stats.data_bytes = bytes_read() - stats.metadata_bytes;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+  }
+
+  rocksdb::Options options_;
+  uint64_t budget_bytes_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::deque<std::vector<std::string>> pending_;
+  std::vector<std::string> hot_keys_;
+  uint64_t next_hot_key_ = 0;
+  WarmupStats stats_;
+  std::thread thread_;
+};
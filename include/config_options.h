@@ -4,6 +4,7 @@
 #include <rocksdb/options.h>
 #include <rocksdb/table.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "db_env.h"
@@ -53,6 +54,40 @@ inline void configureOptions(const DBEnv & env, Options& options) {
   options.memtable_factory = std::make_shared<DBEnv::memtable_factory>();
 }
 
+/**
+ * Creates the block cache. The priority pool ratios only apply to LRU, HyperClockCache has no separate pools.
+ * With a secondary cache, capacity stays the size of the primary cache and the compressed tier comes on top of it.
+ */
+inline std::shared_ptr<Cache> createBlockCache(const DBEnv & env) {
+  const bool hyper_clock = env.cache_type != CacheType::kLRU;
+
+  LRUCacheOptions lru_options(env.capacity, env.num_shard_bits, env.strict_capacity_limit, env.cache_high_priority_ratio);
+
+  const size_t estimated_entry_charge = env.cache_type == CacheType::kAutoHyperClock ? 0
+    : env.estimated_entry_charge > 0 ? env.estimated_entry_charge : env.GetBlockSize();
+  HyperClockCacheOptions hyper_clock_options(env.capacity, estimated_entry_charge, env.num_shard_bits,
+    env.strict_capacity_limit);
+  hyper_clock_options.min_avg_entry_charge = env.min_avg_entry_charge;
+
+  if (env.secondary_cache_capacity == 0)
+    return hyper_clock ? hyper_clock_options.MakeSharedCache() : lru_options.MakeSharedCache();
+
+  TieredCacheOptions tiered_options;
+  if (hyper_clock) {
+    tiered_options.cache_opts = &hyper_clock_options;
+    tiered_options.cache_type = PrimaryCacheType::kCacheTypeHCC;
+  } else {
+    tiered_options.cache_opts = &lru_options;
+    tiered_options.cache_type = PrimaryCacheType::kCacheTypeLRU;
+  }
+  tiered_options.adm_policy = env.secondary_cache_admission_policy;
+  tiered_options.comp_cache_opts.compression_type = env.secondary_cache_compression;
+  tiered_options.total_capacity = env.capacity + env.secondary_cache_capacity;
+  tiered_options.compressed_secondary_ratio =
+    static_cast<double>(env.secondary_cache_capacity) / static_cast<double>(tiered_options.total_capacity);
+  return NewTieredCache(tiered_options);
+}
+
 inline void configureTableOptions(const DBEnv & env, BlockBasedTableOptions& table_options) {
   if (env.bits_per_key > 0) {
     table_options.filter_policy.reset(NewBloomFilterPolicy(env.bits_per_key, false));
@@ -65,18 +100,17 @@ inline void configureTableOptions(const DBEnv & env, BlockBasedTableOptions& tab
   table_options.data_block_index_type = env.data_block_index_type;
   table_options.no_block_cache = env.no_block_cache;
 
-  if (env.capacity > 0) {
-    const std::shared_ptr<Cache> cache = NewLRUCache(
-      env.capacity, env.num_shard_bits,
-      env.strict_capacity_limit, env.cache_high_priority_ratio);
-    table_options.block_cache = cache;
-  }
+  if (env.capacity > 0)
+    table_options.block_cache = createBlockCache(env);
 
   table_options.block_size = env.GetBlockSize();
 
   table_options.read_amp_bytes_per_bit = env.read_amp_bytes_per_bit;
   table_options.enable_index_compression = env.enable_index_compression;
 
+  table_options.max_auto_readahead_size = env.max_auto_readahead_size;
+  table_options.initial_auto_readahead_size = std::min(env.initial_auto_readahead_size, env.max_auto_readahead_size);
+
   MetadataCacheOptions metadata_cache_options;
   metadata_cache_options.top_level_index_pinning = env.top_level_index_pinning;
   metadata_cache_options.partition_pinning = env.partition_pinning;
@@ -90,6 +124,15 @@ inline void configureReadOptions(const DBEnv & env, ReadOptions& read_options) {
   read_options.ignore_range_deletions = env.ignore_range_deletions;
 }
 
+/** Scans start from the point lookup options and override whether they fill the cache and how they read ahead */
+inline void configureScanReadOptions(const DBEnv & env, ReadOptions& read_options) {
+  configureReadOptions(env, read_options);
+  read_options.fill_cache = env.scan_fill_cache;
+  read_options.readahead_size = env.readahead_size;
+  read_options.adaptive_readahead = env.adaptive_readahead;
+  read_options.async_io = env.scan_async_io;
+}
+
 inline void configureWriteOptions(const DBEnv & env, WriteOptions& write_options) {
   write_options.sync = env.sync;
   write_options.disableWAL = env.disableWAL;
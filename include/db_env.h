@@ -1,20 +1,64 @@
 #pragma once
 
 #include <rocksdb/advanced_options.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/table.h>
 
+#include <filesystem>
+
+#include "workload_file.h"
+
+/** The block cache implementation */
+enum class CacheType {
+  kLRU,
+  /** HyperClockCache with a fixed estimated entry charge */
+  kHyperClock,
+  /** HyperClockCache that grows its table as needed (an estimated entry charge of 0) */
+  kAutoHyperClock,
+};
+
+/** Where a scan gets its iterator from */
+enum class ScanIteratorPolicy {
+  /** Every client keeps one iterator, refreshed before every scan */
+  kReused,
+  /** Every scan creates its own iterator */
+  kPerScan,
+};
+
 /** For fields that can be set from the command line, defaults are provided in this namespace */
 namespace Default {
 
   const std::string WORKLOAD_FILE_PATH = "workload.txt";  // [w]
   const std::string OUTPUT_FILE_PATH = "output.txt";  // [o]
   const std::string DB_PATH = "./db";  // [--path]
+  const std::string FROM_CHECKPOINT;  // [from_checkpoint]
 
   constexpr int DEFAULT_LOG_INTERVAL = 100000;  // [interval]
 
   constexpr bool DESTROY_DATABASE = true; // [d]
   constexpr bool CLEAR_SYSTEM_CACHE = true; // [cc]
+  constexpr bool BULK_LOAD = false;  // [bulk_load]
   constexpr bool ENABLE_PERF_IOSTAT = true;  // [stat]
+  constexpr bool RECORD_LATENCY = false;  // [latency]
+  constexpr bool RECORD_INTERVALS = false;  // [interval_stats]
+  constexpr int CACHE_SAMPLE_MILLIS = 0;  // [cache_sample_ms]
+  constexpr int EVENT_WINDOW_MILLIS = 0;  // [event_window_ms]
+  constexpr bool COMPACTION_WARMUP = false;  // [warmup]
+  constexpr int WARMUP_BUDGET_MB = 16;  // [warmup_budget]
+  constexpr int WARMUP_HOT_KEYS = 4096;  // [warmup_hot_keys]
+
+  constexpr int NUM_THREADS = 1;  // [threads]
+  constexpr auto WORKLOAD_PARTITIONING = WorkloadPartitioning::kKeyHash;  // [partition]
+  constexpr int MULTIGET_BATCH_SIZE = 1;  // [multiget]
+  constexpr int WRITE_BATCH_SIZE = 1;  // [write_batch]
+  constexpr size_t WRITE_BATCH_BYTES = 0;  // [write_batch_bytes]
+  constexpr auto SCAN_ITERATOR_POLICY = ScanIteratorPolicy::kReused;  // [scan_iterator]
+  constexpr bool PIN_VALUES = true;  // [pin_values]
+  constexpr bool VERIFY_VALUES = false;  // [verify_values]
+  constexpr double REPLAY_SPEED = 0;  // [replay_speed]
+  const std::string TRACE_FILE_PATH;  // [trace]
+  const std::string BLOCK_CACHE_TRACE_FILE_PATH;  // [block_cache_trace]
+  constexpr uint64_t TRACE_SAMPLING = 1;  // [trace_sampling]
 
   constexpr unsigned int BUFFER_SIZE_IN_PAGES = 4096; // [P]
   constexpr unsigned int ENTRIES_PER_PAGE = 4; // [B]
@@ -30,6 +74,10 @@ namespace Default {
   constexpr int BLOOM_FILTER_BITS_PER_KEY = 10;  // [b]
 
   constexpr int BLOCK_CACHE = 32;  // [bb]
+  constexpr auto CACHE_TYPE = CacheType::kLRU;  // [cache_type]
+  constexpr int SECONDARY_CACHE = 0;  // [sec_cache]
+  constexpr auto SECONDARY_CACHE_COMPRESSION = rocksdb::kLZ4Compression;  // [sec_cache_compression]
+  constexpr auto SECONDARY_CACHE_ADMISSION_POLICY = rocksdb::TieredAdmissionPolicy::kAdmPolicyAuto;  // [sec_cache_admission]
   constexpr bool STRICT_CAPACITY_LIMIT = true;  // [bb_strict]
   constexpr bool CACHE_METADATA_WITH_HIGH_PRIORITY = true;  // [cache_metadata_high_pri]
   constexpr auto METADATA_PINNING = rocksdb::PinningTier::kNone;  // [metadata_pinning]
@@ -52,9 +100,17 @@ public:
     return buffer_size != 0 ? buffer_size : buffer_size_in_pages * entries_per_page * entry_size;
   }
 
+  /** Whether mutations are grouped into write batches at all */
+  [[nodiscard]] bool BatchWrites() const { return write_batch_size > 1 || write_batch_bytes > 0; }
+
   // Control maximum total data size for level base (i.e. level 1)
   [[nodiscard]] uint64_t GetMaxBytesForLevelBase() const { return GetBufferSize() * size_ratio; }
 
+  /** Path for additional results written next to the output file, e.g. output.txt -> output.throughput.json for ".throughput.json" */
+  [[nodiscard]] std::string GetResultPath(const std::string& name) const {
+    return std::filesystem::path(output_file_path).replace_extension(name).string();
+  }
+
   //============================================================================
   // Our own configuration options
 
@@ -64,14 +120,58 @@ public:
   std::string output_file_path = Default::OUTPUT_FILE_PATH;
   /** The path to the database */
   std::string db_path = Default::DB_PATH;
+  /** A base database to start from, whose table files are hard linked into db_path instead of copied (empty for none) */
+  std::string from_checkpoint = Default::FROM_CHECKPOINT;
   /** The interval at which to log */
   int log_interval = Default::DEFAULT_LOG_INTERVAL;
   /** Whether to destroy the database on start */
   bool destroy_database = Default::DESTROY_DATABASE;
   /** Whether to clear the system cache on start */
   bool clear_system_cache = Default::CLEAR_SYSTEM_CACHE;
+  /** Whether to bulk load the inserts of the workload as SST files instead of replaying it */
+  bool bulk_load = Default::BULK_LOAD;
   /** Whether to enable RocksDB's internal Perf and IOstat */
   bool enable_perf_iostat = Default::ENABLE_PERF_IOSTAT;
+  /** Whether to record per-instruction latency histograms */
+  bool record_latency = Default::RECORD_LATENCY;
+  /** Whether to write a time series of statistics at every logging interval */
+  bool record_intervals = Default::RECORD_INTERVALS;
+  /** How often the block cache contents are sampled for the interval statistics (0 disables sampling) */
+  int cache_sample_millis = Default::CACHE_SAMPLE_MILLIS;
+  /** The window around each flush and compaction for the cache hit rates of the event timeline (0 disables it) */
+  int event_window_millis = Default::EVENT_WINDOW_MILLIS;
+  /** Whether to read the blocks of the files a compaction created into the block cache, see CompactionWarmer */
+  bool compaction_warmup = Default::COMPACTION_WARMUP;
+  /** The most the warm-up may read per compaction, in MB (0 is unlimited) */
+  int warmup_budget_mb = Default::WARMUP_BUDGET_MB;
+  /** How many sampled point lookup keys the warm-up reads the data blocks of (0 only warms up index and filters) */
+  int warmup_hot_keys = Default::WARMUP_HOT_KEYS;
+  /** The number of client threads replaying the workload */
+  int num_threads = Default::NUM_THREADS;
+  /** How the workload is split between the client threads */
+  WorkloadPartitioning workload_partitioning = Default::WORKLOAD_PARTITIONING;
+  /** Consecutive point lookups are issued as one MultiGet of up to this many keys (1 disables batching) */
+  int multiget_batch_size = Default::MULTIGET_BATCH_SIZE;
+  /** Consecutive inserts, updates and deletes are grouped into one WriteBatch of up to this many ops */
+  int write_batch_size = Default::WRITE_BATCH_SIZE;
+  /** A WriteBatch is also committed once it reaches this many bytes (0 for no limit) */
+  size_t write_batch_bytes = Default::WRITE_BATCH_BYTES;
+  ScanIteratorPolicy scan_iterator_policy = Default::SCAN_ITERATOR_POLICY;
+  /** Point lookups read their value through a PinnableSlice, so values in the block cache are not copied */
+  bool pin_values = Default::PIN_VALUES;
+  /** Point lookups read every value through and hash it into the value checksum */
+  bool verify_values = Default::VERIFY_VALUES;
+  /**
+   * Ops of a workload with timestamps, e.g. an imported trace, are issued no earlier than their timestamp divided by
+   * this factor (1 is the original pace, 0 replays as fast as possible)
+   */
+  double replay_speed = Default::REPLAY_SPEED;
+  /** Where to record a RocksDB query trace of the replay (empty for none) */
+  std::string trace_file_path = Default::TRACE_FILE_PATH;
+  /** Where to record a RocksDB block cache trace of the replay (empty for none) */
+  std::string block_cache_trace_file_path = Default::BLOCK_CACHE_TRACE_FILE_PATH;
+  /** Only every this many queries, or block keys for the block cache trace, are traced */
+  uint64_t trace_sampling = Default::TRACE_SAMPLING;
 
   unsigned int entry_size = Default::ENTRY_SIZE;
   unsigned int entries_per_page = Default::ENTRIES_PER_PAGE;
@@ -138,6 +238,10 @@ public:
 
   bool enable_index_compression = true;  // 534
 
+  /** Readahead for iterators that read more than num_file_reads_for_auto_readahead blocks of a file, 0 disables it */
+  size_t max_auto_readahead_size = 256 * 1024;
+  size_t initial_auto_readahead_size = 8 * 1024;
+
   /* See MetadataCacheOptions in table.h */
 
   /** This option is only relevant to partitioned indexes and filters */
@@ -153,6 +257,7 @@ public:
   int capacity = 1024 * 1024 * Default::BLOCK_CACHE;  // Line 132 in cache.h
   int num_shard_bits = -1;  // 138
   bool strict_capacity_limit = Default::STRICT_CAPACITY_LIMIT;  // 145
+  CacheType cache_type = Default::CACHE_TYPE;
 
   /* See LRUCacheOptions in cache.h */
 
@@ -160,12 +265,40 @@ public:
   // Unclear what adding another priority does (might only be applicable to BlobDB)
   double cache_low_priority_ratio = 0.0;  // 238
 
+  /* See HyperClockCacheOptions in cache.h */
+
+  /** The expected charge of a cache entry for kHyperClock, 0 uses the block size */
+  size_t estimated_entry_charge = 0;
+  /** The lower bound on the average entry charge that kAutoHyperClock sizes its table for */
+  int min_avg_entry_charge = 450;
+
+  /* See TieredCacheOptions and CompressedSecondaryCacheOptions in cache.h */
+
+  /** The capacity of the compressed secondary cache in bytes, on top of capacity (0 disables it) */
+  size_t secondary_cache_capacity = 1024 * 1024 * Default::SECONDARY_CACHE;
+  rocksdb::CompressionType secondary_cache_compression = Default::SECONDARY_CACHE_COMPRESSION;
+  /** Which blocks evicted from the primary cache are admitted into the secondary cache */
+  rocksdb::TieredAdmissionPolicy secondary_cache_admission_policy = Default::SECONDARY_CACHE_ADMISSION_POLICY;
+
   //============================================================================
   /* See ReadOptions in options.h */
 
   bool verify_checksums = true;  // Line 1704 in options.h
   bool fill_cache = true;  // 1711
   bool ignore_range_deletions = false;  // 1718
+  /** Only applied to MultiGet, and only takes effect if RocksDB was built with coroutine support */
+  bool multiget_async_io = false;
+
+  /* The read options of scans, see configureScanReadOptions */
+
+  /** Scans that fill the cache can evict the hot set of the point lookups */
+  bool scan_fill_cache = true;
+  /** A fixed readahead for scans, 0 leaves it to the auto readahead of the table */
+  size_t readahead_size = 0;
+  /** Carries the auto readahead size over from one file to the next within a scan */
+  bool adaptive_readahead = false;
+  /** Prefetches the next blocks of a scan asynchronously, if RocksDB supports it */
+  bool scan_async_io = false;
 
   /* See WriteOptions in options.h */
 
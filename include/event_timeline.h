@@ -0,0 +1,231 @@
+#pragma once
+
+#include <rocksdb/listener.h>
+#include <rocksdb/statistics.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ASSERT_message.h"
+
+/** One flush or compaction, as seen by the event listener */
+struct BackgroundJobEvent {
+  /** "flush" or "compaction" */
+  std::string type;
+  int job_id = 0;
+  /** Seconds since the timeline started */
+  double start_seconds = 0;
+  double end_seconds = 0;
+  /** -1 for flushes, which read the memtable */
+  int input_level = -1;
+  int output_level = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  uint64_t files_created = 0;
+  uint64_t files_deleted = 0;
+  /** The FlushReason or CompactionReason */
+  int reason = 0;
+  bool ok = true;
+};
+
+/**
+ * Records every flush and compaction with its timing and IO, and samples the block cache hit and miss tickers and the
+ * Get latency histogram on a background thread, so that each event can be written out with the hit rate and mean Get
+ * latency in a window before and after it.
+ */
+class EventTimeline {
+public:
+  EventTimeline(std::shared_ptr<rocksdb::Statistics> statistics, const std::chrono::milliseconds sample_period) :
+    statistics_(std::move(statistics)), sample_period_(sample_period), start_(std::chrono::steady_clock::now()) {
+    if (statistics_) {
+      Sample();
+      thread_ = std::thread([this] { Run(); });
+    }
+  }
+
+  ~EventTimeline() { Stop(); }
+
+  EventTimeline(const EventTimeline&) = delete;
+  EventTimeline& operator=(const EventTimeline&) = delete;
+
+  [[nodiscard]] std::chrono::steady_clock::time_point StartTime() const { return start_; }
+
+  void OnFlushBegin(const rocksdb::FlushJobInfo& info) { Begin(info.job_id); }
+
+  void OnFlushCompleted(const rocksdb::FlushJobInfo& info) {
+    BackgroundJobEvent event;
+    event.type = "flush";
+    event.job_id = info.job_id;
+    event.output_level = 0;
+    event.bytes_written = info.table_properties.data_size + info.table_properties.index_size
+      + info.table_properties.filter_size;
+    event.files_created = 1;
+    event.reason = static_cast<int>(info.flush_reason);
+    Complete(event);
+  }
+
+  void OnCompactionBegin(const rocksdb::CompactionJobInfo& info) { Begin(info.job_id); }
+
+  void OnCompactionCompleted(const rocksdb::CompactionJobInfo& info) {
+    BackgroundJobEvent event;
+    event.type = "compaction";
+    event.job_id = info.job_id;
+    event.input_level = info.base_input_level;
+    event.output_level = info.output_level;
+    event.bytes_read = info.stats.total_input_bytes;
+    event.bytes_written = info.stats.total_output_bytes;
+    event.files_created = info.output_files.size();
+    event.files_deleted = info.input_files.size();
+    event.reason = static_cast<int>(info.compaction_reason);
+    event.ok = info.status.ok();
+    Complete(event);
+  }
+
+  /** Stops sampling. Events that complete afterwards are still recorded, but have no hit rate after them. */
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  /**
+   * Writes the events as CSV, with the block cache hit rate and mean Get latency in the window before each event began
+   * and after it ended
+   */
+  void Write(const std::string& path, const std::chrono::milliseconds window) {
+    Stop();
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    ASSERT(file.is_open(), "Failed to open output file " + path);
+    file << "type,job_id,start_seconds,end_seconds,input_level,output_level,bytes_read,bytes_written,"
+      << "files_created,files_deleted,reason,ok,lookups_before,hit_rate_before,lookups_after,hit_rate_after,"
+      << "get_micros_before,get_micros_after" << std::endl;
+
+    const double window_seconds = std::chrono::duration<double>(window).count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& event : events_) {
+      const WindowStats before = Window(event.start_seconds - window_seconds, event.start_seconds);
+      const WindowStats after = Window(event.end_seconds, event.end_seconds + window_seconds);
+      file << event.type
+        << "," << event.job_id
+        << "," << event.start_seconds
+        << "," << event.end_seconds
+        << "," << event.input_level
+        << "," << event.output_level
+        << "," << event.bytes_read
+        << "," << event.bytes_written
+        << "," << event.files_created
+        << "," << event.files_deleted
+        << "," << event.reason
+        << "," << event.ok
+        << "," << before.lookups
+        << "," << before.hit_rate
+        << "," << after.lookups
+        << "," << after.hit_rate
+        << "," << before.get_micros
+        << "," << after.get_micros
+        << "\n";
+    }
+  }
+
+private:
+  struct TickerSample {
+    double seconds;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t gets;
+    uint64_t get_micros;
+  };
+
+  struct WindowStats {
+    uint64_t lookups = 0;
+    double hit_rate = 0;
+    /** The mean latency of the Gets in the window */
+    double get_micros = 0;
+  };
+
+  [[nodiscard]] double Now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+
+  void Begin(const int job_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_starts_[job_id] = Now();
+  }
+
+  void Complete(BackgroundJobEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    event.end_seconds = Now();
+    const auto it = job_starts_.find(event.job_id);
+    event.start_seconds = it != job_starts_.end() ? it->second : event.end_seconds;
+    if (it != job_starts_.end())
+      job_starts_.erase(it);
+    events_.push_back(std::move(event));
+  }
+
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, sample_period_, [this] { return stop_; })) {
+      lock.unlock();
+      Sample();
+      lock.lock();
+    }
+  }
+
+  void Sample() {
+    rocksdb::HistogramData gets;
+    statistics_->histogramData(rocksdb::DB_GET, &gets);
+    const TickerSample sample = {Now(), statistics_->getTickerCount(rocksdb::BLOCK_CACHE_HIT),
+      statistics_->getTickerCount(rocksdb::BLOCK_CACHE_MISS), gets.count, gets.sum};
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    samples_.push_back(sample);
+  }
+
+  /** The block cache lookups and Get latency between two points in time, using the samples closest to them */
+  WindowStats Window(const double from, const double to) {
+    WindowStats stats;
+    std::lock_guard<std::mutex> lock(samples_mutex_);
+    if (samples_.empty())
+      return stats;
+
+    const auto at = [this](const double seconds) {
+      const auto it = std::upper_bound(samples_.begin(), samples_.end(), seconds,
+        [](const double value, const TickerSample& sample) { return value < sample.seconds; });
+      return it == samples_.begin() ? *it : *(it - 1);
+    };
+    const TickerSample first = at(from), last = at(to);
+    const uint64_t hits = last.hits - first.hits;
+    stats.lookups = hits + last.misses - first.misses;
+    stats.hit_rate = stats.lookups > 0 ? static_cast<double>(hits) / stats.lookups : 0;
+    const uint64_t gets = last.gets - first.gets;
+    stats.get_micros = gets > 0 ? static_cast<double>(last.get_micros - first.get_micros) / gets : 0;
+    return stats;
+  }
+
+  std::shared_ptr<rocksdb::Statistics> statistics_;
+  std::chrono::milliseconds sample_period_;
+  std::chrono::steady_clock::time_point start_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::map<int, double> job_starts_;
+  std::vector<BackgroundJobEvent> events_;
+
+  std::mutex samples_mutex_;
+  std::vector<TickerSample> samples_;
+  std::thread thread_;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <rocksdb/db.h>
+#include <rocksdb/statistics.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ASSERT_message.h"
+#include "cache_occupancy.h"
+
+/**
+ * Appends one CSV row per logging interval, so that warm-up curves and post-compaction dips show up over time
+ * instead of being averaged into the end-of-run dump. Cache counters are deltas over the interval.
+ *
+ * The intervals are counted in the ops of all clients together, and any client can take the snapshot. The counters
+ * come from the DB-wide statistics, apart from the range deletion reseeks, which only the perf contexts of the
+ * clients have, so the clients pass in their sum.
+ */
+class IntervalStats {
+public:
+  IntervalStats(const std::string& path, rocksdb::DB *db, std::shared_ptr<rocksdb::Statistics> statistics,
+    const uint64_t interval_ops) :
+    file_(path, std::ios::out | std::ios::trunc), db_(db), statistics_(std::move(statistics)),
+    interval_ops_(std::max<uint64_t>(1, interval_ops)) {
+    ASSERT(file_.is_open(), "Failed to open output file " + path);
+    file_ << "seconds,ops,interval_ops,ops_per_sec,block_cache_hit,block_cache_miss,block_cache_hit_rate,secondary_cache_hit,"
+      << "sst_read_count,range_del_reseeks,stall_micros,pending_compaction_bytes,running_compactions,running_flushes,"
+      << "cache_usage,cache_pinned_usage,cache_entries,cache_data_bytes,cache_index_bytes,cache_filter_bytes,"
+      << "cache_other_bytes,cache_high_priority_bytes" << std::endl;
+  }
+
+  /** Adds the latest sample of the given sampler to every row, the cache columns stay 0 without one */
+  void SetCacheSampler(const CacheOccupancySampler *sampler) { cache_sampler_ = sampler; }
+
+  /** Takes the baseline for the deltas, the time column counts from origin */
+  void Start(const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now()) {
+    start_ = origin;
+    last_time_ = std::chrono::steady_clock::now();
+    last_ops_ = 0;
+    next_ops_ = interval_ops_;
+    last_hits_ = Ticker(rocksdb::BLOCK_CACHE_HIT);
+    last_misses_ = Ticker(rocksdb::BLOCK_CACHE_MISS);
+    last_secondary_hits_ = Ticker(rocksdb::SECONDARY_CACHE_HITS);
+    last_sst_reads_ = SstReads();
+    last_range_del_reseeks_ = 0;
+    last_stall_micros_ = Ticker(rocksdb::STALL_MICROS);
+  }
+
+  /** Appends a row if the ops of all clients have passed the end of the current interval */
+  void MaybeSnapshot(const uint64_t total_ops, const uint64_t range_del_reseeks) {
+    std::lock_guard lock(mutex_);
+    if (total_ops >= next_ops_)
+      Append(total_ops, range_del_reseeks);
+  }
+
+  /** Appends a row for the interval since the previous snapshot, e.g. the partial interval at the end of the run */
+  void Snapshot(const uint64_t total_ops, const uint64_t range_del_reseeks) {
+    std::lock_guard lock(mutex_);
+    Append(total_ops, range_del_reseeks);
+  }
+
+private:
+  /**
+   * Given the ops replayed and the range deletion reseeks of all clients so far. The SST reads are the foreground
+   * reads of the whole DB, RocksDB does not count the reads of compactions in SST_READ_MICROS.
+   */
+  void Append(const uint64_t total_ops, const uint64_t range_del_reseeks) {
+    const auto now = std::chrono::steady_clock::now();
+    const double interval_seconds = std::chrono::duration<double>(now - last_time_).count();
+    const uint64_t hits = Ticker(rocksdb::BLOCK_CACHE_HIT);
+    const uint64_t misses = Ticker(rocksdb::BLOCK_CACHE_MISS);
+    const uint64_t secondary_hits = Ticker(rocksdb::SECONDARY_CACHE_HITS);
+    const uint64_t sst_reads = SstReads();
+    const uint64_t stall_micros = Ticker(rocksdb::STALL_MICROS);
+
+    const uint64_t interval_ops = total_ops - last_ops_;
+    const uint64_t interval_hits = hits - last_hits_;
+    const uint64_t interval_misses = misses - last_misses_;
+    const uint64_t lookups = interval_hits + interval_misses;
+
+    uint64_t pending_compaction_bytes = 0, running_compactions = 0, running_flushes = 0;
+    db_->GetIntProperty(rocksdb::DB::Properties::kEstimatePendingCompactionBytes, &pending_compaction_bytes);
+    db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningCompactions, &running_compactions);
+    db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningFlushes, &running_flushes);
+
+    file_ << std::chrono::duration<double>(now - start_).count()
+      << "," << total_ops
+      << "," << interval_ops
+      << "," << (interval_seconds > 0 ? interval_ops / interval_seconds : 0)
+      << "," << interval_hits
+      << "," << interval_misses
+      << "," << (lookups > 0 ? static_cast<double>(interval_hits) / lookups : 0)
+      << "," << secondary_hits - last_secondary_hits_
+      << "," << sst_reads - last_sst_reads_
+      << "," << range_del_reseeks - last_range_del_reseeks_
+      << "," << stall_micros - last_stall_micros_
+      << "," << pending_compaction_bytes
+      << "," << running_compactions
+      << "," << running_flushes;
+
+    const CacheOccupancy occupancy = cache_sampler_ ? cache_sampler_->Latest() : CacheOccupancy();
+    file_ << "," << occupancy.usage
+      << "," << occupancy.pinned_usage
+      << "," << occupancy.entries
+      << "," << occupancy.data_bytes
+      << "," << occupancy.index_bytes
+      << "," << occupancy.filter_bytes
+      << "," << occupancy.other_bytes
+      << "," << occupancy.high_priority_bytes
+      << "\n";
+
+    last_time_ = now;
+    last_ops_ = total_ops;
+    while (next_ops_ <= total_ops)
+      next_ops_ += interval_ops_;
+    last_hits_ = hits;
+    last_misses_ = misses;
+    last_secondary_hits_ = secondary_hits;
+    last_sst_reads_ = sst_reads;
+    last_range_del_reseeks_ = range_del_reseeks;
+    last_stall_micros_ = stall_micros;
+  }
+
+  [[nodiscard]] uint64_t Ticker(const uint32_t ticker) const {
+    return statistics_ ? statistics_->getTickerCount(ticker) : 0;
+  }
+
+  [[nodiscard]] uint64_t SstReads() const {
+    if (!statistics_)
+      return 0;
+    rocksdb::HistogramData data;
+    statistics_->histogramData(rocksdb::SST_READ_MICROS, &data);
+    return data.count;
+  }
+
+  std::ofstream file_;
+  rocksdb::DB *db_;
+  std::shared_ptr<rocksdb::Statistics> statistics_;
+  const CacheOccupancySampler *cache_sampler_ = nullptr;
+  uint64_t interval_ops_;
+  std::mutex mutex_;
+
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point last_time_;
+  uint64_t last_ops_ = 0;
+  uint64_t next_ops_ = 0;
+  uint64_t last_hits_ = 0;
+  uint64_t last_misses_ = 0;
+  uint64_t last_secondary_hits_ = 0;
+  uint64_t last_sst_reads_ = 0;
+  uint64_t last_range_del_reseeks_ = 0;
+  uint64_t last_stall_micros_ = 0;
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * A log-linear latency histogram in the style of HdrHistogram.
+ * Every power of two is split into 2^SUB_BUCKET_BITS linear sub-buckets, so any recorded value is
+ * reported with a relative error below 2^-SUB_BUCKET_BITS, while recording stays a handful of integer ops.
+ * Values below 2^SUB_BUCKET_BITS are stored exactly.
+ */
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 7;
+  static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+  static constexpr size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  LatencyHistogram() : counts_(NUM_BUCKETS, 0) {}
+
+  void Record(const uint64_t value) {
+    counts_[BucketIndex(value)]++;
+    count_++;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < NUM_BUCKETS; i++)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  /** The value at the given percentile (0-100), reported as the upper end of its bucket */
+  [[nodiscard]] uint64_t Percentile(const double percentile) const {
+    if (count_ == 0)
+      return 0;
+
+    const auto rank = static_cast<uint64_t>(std::max(1.0, percentile / 100 * count_ + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+      seen += counts_[i];
+      if (seen >= rank)
+        return std::clamp(BucketUpperBound(i), min_, max_);
+    }
+    return max_;
+  }
+
+  [[nodiscard]] uint64_t Count() const { return count_; }
+  [[nodiscard]] uint64_t Min() const { return count_ > 0 ? min_ : 0; }
+  [[nodiscard]] uint64_t Max() const { return max_; }
+  [[nodiscard]] double Mean() const { return count_ > 0 ? static_cast<double>(sum_) / count_ : 0; }
+
+  /** Writes the summary as a JSON object */
+  void WriteJson(std::ostream& out) const {
+    out << "{\"count\": " << Count()
+      << ", \"min\": " << Min()
+      << ", \"mean\": " << Mean()
+      << ", \"p50\": " << Percentile(50)
+      << ", \"p90\": " << Percentile(90)
+      << ", \"p99\": " << Percentile(99)
+      << ", \"p99.9\": " << Percentile(99.9)
+      << ", \"p99.99\": " << Percentile(99.99)
+      << ", \"max\": " << Max() << "}";
+  }
+
+private:
+  /** The position of the highest set bit of a non-zero value */
+  static int MostSignificantBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    int msb = 0;
+    while (value >>= 1)
+      msb++;
+    return msb;
+#endif
+  }
+
+  static size_t BucketIndex(const uint64_t value) {
+    if (value < SUB_BUCKETS)
+      return value;
+
+    const int msb = MostSignificantBit(value);
+    const int shift = msb - SUB_BUCKET_BITS;
+    return (static_cast<size_t>(shift) + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+  }
+
+  static uint64_t BucketUpperBound(const size_t index) {
+    if (index < SUB_BUCKETS)
+      return index;
+
+    const int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t min_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_ = 0;
+};
+
+/** One latency histogram per workload instruction */
+class OpLatencies {
+public:
+  /**
+   * The instructions that get a histogram, in output order.
+   * M stands for batched point lookups (MultiGet) and W for batched writes (WriteBatch).
+   */
+  static constexpr std::array<char, 8> INSTRUCTIONS = {'I', 'U', 'D', 'R', 'Q', 'S', 'M', 'W'};
+
+  void Record(const char instruction, const uint64_t nanos) {
+    if (LatencyHistogram *histogram = ForInstruction(instruction))
+      histogram->Record(nanos);
+  }
+
+  void Merge(const OpLatencies& other) {
+    for (size_t i = 0; i < INSTRUCTIONS.size(); i++)
+      histograms_[i].Merge(other.histograms_[i]);
+  }
+
+  LatencyHistogram *ForInstruction(const char instruction) {
+    for (size_t i = 0; i < INSTRUCTIONS.size(); i++) {
+      if (INSTRUCTIONS[i] == instruction)
+        return &histograms_[i];
+    }
+    return nullptr;
+  }
+
+  /** Writes the histograms of the instructions that were seen as a JSON object, with latencies in nanoseconds */
+  void WriteJson(std::ostream& out) const {
+    out << "{\"unit\": \"ns\", \"ops\": {";
+    bool first = true;
+    for (size_t i = 0; i < INSTRUCTIONS.size(); i++) {
+      if (histograms_[i].Count() == 0)
+        continue;
+      out << (first ? "" : ", ") << "\"" << INSTRUCTIONS[i] << "\": ";
+      histograms_[i].WriteJson(out);
+      first = false;
+    }
+    out << "}}";
+  }
+
+  /** Prints one line per instruction that was seen, with latencies in microseconds */
+  void Print(std::ostream& out) const {
+    for (size_t i = 0; i < INSTRUCTIONS.size(); i++) {
+      const LatencyHistogram& histogram = histograms_[i];
+      if (histogram.Count() == 0)
+        continue;
+      out << INSTRUCTIONS[i] << ": count " << histogram.Count()
+        << ", p50 " << histogram.Percentile(50) / 1000.0
+        << " us, p99 " << histogram.Percentile(99) / 1000.0
+        << " us, p99.9 " << histogram.Percentile(99.9) / 1000.0
+        << " us, max " << histogram.Max() / 1000.0 << " us" << std::endl;
+    }
+  }
+
+private:
+  std::array<LatencyHistogram, INSTRUCTIONS.size()> histograms_;
+};
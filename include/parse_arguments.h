@@ -15,14 +15,78 @@ inline void ParseArguments(const int argc, char *argv[], DBEnv& env) {
     {'o', "output"});
   args::ValueFlag<std::string> db_path(group, "path", "The path to the database [default: ./db]",
     {"path"});
+  args::ValueFlag<std::string> from_checkpoint_cmd(group, "from_checkpoint", "Start from a clone of this base database, sharing its SST files [default: none]",
+    {"from_checkpoint"});
   args::ValueFlag<int> log_interval_cmd(group, "interval", "The interval at which to log [default: 100000]",
     {"interval"});
   args::ValueFlag<int> destroy_database_cmd(group, "d", "Destroy and recreate the database [def: 1]",
     {'d', "destroy"});
   args::ValueFlag<int> clear_system_cache_cmd(group, "cc", "Clear system cache [def: 1]",
     {"cc"});
+  args::ValueFlag<int> bulk_load_cmd(group, "bulk_load", "Bulk load the inserts of the workload as SST files instead of replaying it [default: 0]",
+    {"bulk_load"});
   args::ValueFlag<int> enable_perf_iostat_cmd(group, "enable_perf_iostat", "Enable RocksDB's internal Perf and IOstat [default: 1]",
     {"stat"});
+  args::ValueFlag<int> record_latency_cmd(group, "latency", "Record per-instruction latency histograms, which times every op [default: 0]",
+    {"latency"});
+  args::ValueFlag<int> record_intervals_cmd(group, "interval_stats", "Write a time series of statistics at every logging interval [default: 0]",
+    {"interval_stats"});
+  args::ValueFlag<int> cache_sample_millis_cmd(group, "cache_sample_ms", "Sample the block cache contents for the interval statistics every this many ms, 0 disables it [default: 0]",
+    {"cache_sample_ms"});
+  args::ValueFlag<int> event_window_millis_cmd(group, "event_window_ms", "Report the block cache hit rate this many ms before and after every flush and compaction, 0 disables the event timeline [default: 0]",
+    {"event_window_ms"});
+  args::ValueFlag<int> compaction_warmup_cmd(group, "warmup", "Read the index, filter and hot data blocks of compaction outputs into the block cache [default: 0]",
+    {"warmup"});
+  args::ValueFlag<int> warmup_budget_cmd(group, "warmup_budget", "The most the warm-up reads per compaction in MB, 0 is unlimited [default: 16]",
+    {"warmup_budget"});
+  args::ValueFlag<int> warmup_hot_keys_cmd(group, "warmup_hot_keys", "The number of sampled lookup keys whose data blocks the warm-up reads [default: 4096]",
+    {"warmup_hot_keys"});
+  args::ValueFlag<int> num_threads_cmd(group, "threads", "The number of client threads replaying the workload [default: 1]",
+    {"threads"});
+  args::ValueFlag<int> workload_partitioning_cmd(group, "partition", "How the workload is split between threads [1: round robin, 2: key hash; default: 2]",
+    {"partition"});
+  args::ValueFlag<int> multiget_batch_size_cmd(group, "multiget", "Batch up to this many consecutive point lookups into a MultiGet [default: 1, no batching]",
+    {"multiget"});
+  args::ValueFlag<int> multiget_async_io_cmd(group, "multiget_async", "Use async IO for MultiGet, if RocksDB supports it [default: 0]",
+    {"multiget_async"});
+  args::ValueFlag<int> pin_values_cmd(group, "pin_values", "Point lookups pin their value instead of copying it out of the block cache [default: 1]",
+    {"pin_values"});
+  args::ValueFlag<int> verify_values_cmd(group, "verify_values", "Read through and checksum every point lookup value [default: 0]",
+    {"verify_values"});
+  args::ValueFlag<double> replay_speed_cmd(group, "replay_speed", "Replay a workload with timestamps at this multiple of its original pace, 0 is as fast as possible [default: 0]",
+    {"replay_speed"});
+  args::ValueFlag<std::string> trace_cmd(group, "trace", "Record a RocksDB query trace of the replay to this file [default: none]",
+    {"trace"});
+  args::ValueFlag<std::string> block_cache_trace_cmd(group, "block_cache_trace", "Record a RocksDB block cache trace of the replay to this file [default: none]",
+    {"block_cache_trace"});
+  args::ValueFlag<long> trace_sampling_cmd(group, "trace_sampling", "Trace only every this many queries, or block keys for the block cache trace [default: 1]",
+    {"trace_sampling"});
+  args::ValueFlag<int> fill_cache_cmd(group, "fill_cache", "Point lookups fill the block cache [default: 1]",
+    {"fill_cache"});
+  args::ValueFlag<int> scan_fill_cache_cmd(group, "scan_fill_cache", "Scans fill the block cache [default: 1]",
+    {"scan_fill_cache"});
+  args::ValueFlag<int> scan_async_io_cmd(group, "scan_async_io", "Prefetch scan blocks asynchronously, if RocksDB supports it [default: 0]",
+    {"scan_async_io"});
+  args::ValueFlag<int> scan_iterator_cmd(group, "scan_iterator", "Where scans get their iterator [1: one per client, refreshed per scan, 2: one per scan; default: 1]",
+    {"scan_iterator"});
+  args::ValueFlag<long> readahead_size_cmd(group, "readahead_size", "Fixed scan readahead in bytes [default: 0, auto readahead]",
+    {"readahead_size"});
+  args::ValueFlag<int> adaptive_readahead_cmd(group, "adaptive_readahead", "Carry the auto readahead size across files [default: 0]",
+    {"adaptive_readahead"});
+  args::ValueFlag<long> max_auto_readahead_cmd(group, "max_auto_readahead", "Maximum auto readahead in bytes, 0 disables it [default: 262144]",
+    {"max_auto_readahead"});
+  args::ValueFlag<long> initial_auto_readahead_cmd(group, "initial_auto_readahead", "Initial auto readahead in bytes [default: 8192]",
+    {"initial_auto_readahead"});
+  args::ValueFlag<int> ignore_range_deletions_cmd(group, "ignore_range_deletions", "Skip range tombstones on reads [default: 0]",
+    {"ignore_range_deletions"});
+  args::ValueFlag<int> write_batch_size_cmd(group, "write_batch", "Group up to this many consecutive writes into a WriteBatch [default: 1, no batching]",
+    {"write_batch"});
+  args::ValueFlag<long> write_batch_bytes_cmd(group, "write_batch_bytes", "Also commit a WriteBatch once it reaches this many bytes [default: 0, no limit]",
+    {"write_batch_bytes"});
+  args::ValueFlag<int> sync_cmd(group, "sync", "Sync the WAL on every write [default: 0]",
+    {"sync"});
+  args::ValueFlag<int> disable_wal_cmd(group, "disable_wal", "Disable the WAL [default: 0]",
+    {"disable_wal"});
 
   args::ValueFlag<int> size_ratio_cmd(group, "T", "The size ratio for the LSM [default: 10]",
     {'T', "size_ratio"});
@@ -46,6 +110,20 @@ inline void ParseArguments(const int argc, char *argv[], DBEnv& env) {
 
   args::ValueFlag<int> block_cache_cmd(group, "bb", "Block cache size in MB [default: 32 MB]",
     {"bb"});
+  args::ValueFlag<int> cache_type_cmd(group, "cache_type", "Block cache implementation [1: LRUCache, 2: HyperClockCache, 3: AutoHyperClockCache; default: 1]",
+    {"cache_type"});
+  args::ValueFlag<long> estimated_entry_charge_cmd(group, "estimated_entry_charge", "Estimated entry charge for HyperClockCache in bytes [default: 0, the block size]",
+    {"estimated_entry_charge"});
+  args::ValueFlag<int> min_avg_entry_charge_cmd(group, "min_avg_entry_charge", "Minimum average entry charge for AutoHyperClockCache in bytes [default: 450]",
+    {"min_avg_entry_charge"});
+  args::ValueFlag<int> secondary_cache_cmd(group, "sec_cache", "Compressed secondary cache size in MB, on top of --bb [default: 0, disabled]",
+    {"sec_cache"});
+  args::ValueFlag<int> secondary_cache_compression_cmd(group, "sec_cache_compression", "Secondary cache compression [1: kLZ4Compression, 2: kSnappyCompression, 3: kZSTD, 4: kNoCompression; default: 1]",
+    {"sec_cache_compression"});
+  args::ValueFlag<int> secondary_cache_admission_cmd(group, "sec_cache_admission", "Secondary cache admission policy [1: kAdmPolicyAuto, 2: kAdmPolicyPlaceholder, 3: kAdmPolicyAllowCacheHits, 4: kAdmPolicyAllowAll; default: 1]",
+    {"sec_cache_admission"});
+  args::ValueFlag<int> num_shard_bits_cmd(group, "shard_bits", "The number of block cache shard bits [default: -1, chosen by RocksDB]",
+    {"shard_bits"});
   args::ValueFlag<int> strict_capacity_limit_cmd(group, "bb_strict", "Strict capacity limit [default: 1]",
     {"bb_strict"});
   args::ValueFlag<int> cache_metadata_with_high_priority_cmd(group, "cache_metadata_with_high_priority", "Cache metadata with high priority [default: 1]",
@@ -66,6 +144,9 @@ inline void ParseArguments(const int argc, char *argv[], DBEnv& env) {
   if (db_path)
     env.db_path = get(db_path);
 
+  if (from_checkpoint_cmd)
+    env.from_checkpoint = get(from_checkpoint_cmd);
+
   if (log_interval_cmd)
     env.log_interval = get(log_interval_cmd);
 
@@ -75,9 +156,105 @@ inline void ParseArguments(const int argc, char *argv[], DBEnv& env) {
   if (clear_system_cache_cmd)
     env.clear_system_cache = get(clear_system_cache_cmd);
 
+  if (bulk_load_cmd)
+    env.bulk_load = get(bulk_load_cmd);
+
   if (enable_perf_iostat_cmd)
     env.enable_perf_iostat = get(enable_perf_iostat_cmd);
 
+  if (record_latency_cmd)
+    env.record_latency = get(record_latency_cmd);
+
+  if (record_intervals_cmd)
+    env.record_intervals = get(record_intervals_cmd);
+
+  if (cache_sample_millis_cmd)
+    env.cache_sample_millis = get(cache_sample_millis_cmd);
+  if (event_window_millis_cmd)
+    env.event_window_millis = get(event_window_millis_cmd);
+  if (compaction_warmup_cmd)
+    env.compaction_warmup = get(compaction_warmup_cmd);
+  if (warmup_budget_cmd)
+    env.warmup_budget_mb = get(warmup_budget_cmd);
+  if (warmup_hot_keys_cmd)
+    env.warmup_hot_keys = get(warmup_hot_keys_cmd);
+
+  if (num_threads_cmd)
+    env.num_threads = get(num_threads_cmd);
+  if (env.num_threads < 1) {
+    std::cerr << "ERROR: At least one client thread is needed to replay the workload" << std::endl;
+    exit(1);
+  }
+
+  constexpr WorkloadPartitioning workload_partitionings[2] = {WorkloadPartitioning::kRoundRobin,
+    WorkloadPartitioning::kKeyHash};
+  if (workload_partitioning_cmd)
+    env.workload_partitioning = workload_partitionings[get(workload_partitioning_cmd) - 1];
+
+  if (multiget_batch_size_cmd)
+    env.multiget_batch_size = get(multiget_batch_size_cmd);
+
+  if (multiget_async_io_cmd)
+    env.multiget_async_io = get(multiget_async_io_cmd);
+
+  if (replay_speed_cmd)
+    env.replay_speed = get(replay_speed_cmd);
+
+  if (trace_cmd)
+    env.trace_file_path = get(trace_cmd);
+
+  if (block_cache_trace_cmd)
+    env.block_cache_trace_file_path = get(block_cache_trace_cmd);
+
+  if (trace_sampling_cmd)
+    env.trace_sampling = get(trace_sampling_cmd);
+
+  if (fill_cache_cmd)
+    env.fill_cache = get(fill_cache_cmd);
+
+  if (scan_fill_cache_cmd)
+    env.scan_fill_cache = get(scan_fill_cache_cmd);
+
+  if (scan_async_io_cmd)
+    env.scan_async_io = get(scan_async_io_cmd);
+
+  if (pin_values_cmd)
+    env.pin_values = get(pin_values_cmd);
+
+  if (verify_values_cmd)
+    env.verify_values = get(verify_values_cmd);
+
+  constexpr ScanIteratorPolicy scan_iterator_policies[2] = {ScanIteratorPolicy::kReused, ScanIteratorPolicy::kPerScan};
+  if (scan_iterator_cmd)
+    env.scan_iterator_policy = scan_iterator_policies[get(scan_iterator_cmd) - 1];
+
+  if (readahead_size_cmd)
+    env.readahead_size = get(readahead_size_cmd);
+
+  if (adaptive_readahead_cmd)
+    env.adaptive_readahead = get(adaptive_readahead_cmd);
+
+  if (max_auto_readahead_cmd)
+    env.max_auto_readahead_size = get(max_auto_readahead_cmd);
+
+  if (initial_auto_readahead_cmd)
+    env.initial_auto_readahead_size = get(initial_auto_readahead_cmd);
+
+  if (ignore_range_deletions_cmd)
+    env.ignore_range_deletions = get(ignore_range_deletions_cmd);
+
+  if (write_batch_size_cmd)
+    env.write_batch_size = get(write_batch_size_cmd);
+
+  if (write_batch_bytes_cmd)
+    env.write_batch_bytes = get(write_batch_bytes_cmd);
+
+  if (sync_cmd)
+    env.sync = get(sync_cmd);
+
+  if (disable_wal_cmd)
+    env.disableWAL = get(disable_wal_cmd);
+
   if (size_ratio_cmd)
     env.size_ratio = get(size_ratio_cmd);
 
@@ -114,6 +291,33 @@ inline void ParseArguments(const int argc, char *argv[], DBEnv& env) {
   if (block_cache_cmd)
     env.capacity = get(block_cache_cmd) * 1024 * 1024;
 
+  constexpr CacheType cache_types[3] = {CacheType::kLRU, CacheType::kHyperClock, CacheType::kAutoHyperClock};
+  if (cache_type_cmd)
+    env.cache_type = cache_types[get(cache_type_cmd) - 1];
+
+  if (estimated_entry_charge_cmd)
+    env.estimated_entry_charge = get(estimated_entry_charge_cmd);
+
+  if (min_avg_entry_charge_cmd)
+    env.min_avg_entry_charge = get(min_avg_entry_charge_cmd);
+
+  if (secondary_cache_cmd)
+    env.secondary_cache_capacity = static_cast<size_t>(get(secondary_cache_cmd)) * 1024 * 1024;
+
+  constexpr rocksdb::CompressionType secondary_cache_compressions[4] = {rocksdb::kLZ4Compression,
+    rocksdb::kSnappyCompression, rocksdb::kZSTD, rocksdb::kNoCompression};
+  if (secondary_cache_compression_cmd)
+    env.secondary_cache_compression = secondary_cache_compressions[get(secondary_cache_compression_cmd) - 1];
+
+  constexpr rocksdb::TieredAdmissionPolicy secondary_cache_admission_policies[4] = {
+    rocksdb::TieredAdmissionPolicy::kAdmPolicyAuto, rocksdb::TieredAdmissionPolicy::kAdmPolicyPlaceholder,
+    rocksdb::TieredAdmissionPolicy::kAdmPolicyAllowCacheHits, rocksdb::TieredAdmissionPolicy::kAdmPolicyAllowAll};
+  if (secondary_cache_admission_cmd)
+    env.secondary_cache_admission_policy = secondary_cache_admission_policies[get(secondary_cache_admission_cmd) - 1];
+
+  if (num_shard_bits_cmd)
+    env.num_shard_bits = get(num_shard_bits_cmd);
+
   if (strict_capacity_limit_cmd)
     env.strict_capacity_limit = get(strict_capacity_limit_cmd);
 
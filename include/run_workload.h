@@ -1,11 +1,15 @@
 #pragma once
 
+#include <rocksdb/block_cache_trace_writer.h>
 #include <rocksdb/db.h>
 #include <rocksdb/iostats_context.h>
 #include <rocksdb/options.h>
 #include <rocksdb/perf_context.h>
 #include <rocksdb/table.h>
+#include <rocksdb/trace_reader_writer.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <ctime>
@@ -15,48 +19,839 @@
 #include <mutex>
 #include <thread>
 
+#include "cache_stats.h"
+#include "clone_db.h"
+#include "compaction_warmup.h"
 #include "config_options.h"
+#include "event_timeline.h"
+#include "interval_stats.h"
+#include "latency_histogram.h"
+#include "workload_file.h"
 
 #include "ASSERT_message.h"
 
 #include <rocksdb/statistics.h>
 
-inline std::mutex mtx;
-inline std::condition_variable cv;
-inline bool compaction_complete = false;
-
 /** Forward declaration */
 void PrintExperimentalSetup(const DBEnv& env);
 
-/** Notifies the cv condition when a compaction is completed. */
+/**
+ * Counts the flushes and compactions of the DB it is attached to, so waiting for background work to settle can
+ * wake up on the event that finishes it instead of polling, records them on the event timeline and hands finished
+ * compactions to the warm-up, if either is given. Attach one listener per DB.
+ */
 class CompactionsListener final : public EventListener {
 public:
-  explicit CompactionsListener() = default;
+  explicit CompactionsListener(std::shared_ptr<EventTimeline> timeline = nullptr,
+    std::shared_ptr<CompactionWarmer> warmer = nullptr) : timeline_(std::move(timeline)), warmer_(std::move(warmer)) {}
+
+  void OnFlushBegin(DB *db, const FlushJobInfo &fi) override {
+    if (timeline_)
+      timeline_->OnFlushBegin(fi);
+    Begin(running_flushes_);
+  }
+
+  void OnFlushCompleted(DB *db, const FlushJobInfo &fi) override {
+    if (timeline_)
+      timeline_->OnFlushCompleted(fi);
+    Complete(running_flushes_, num_flushes_);
+  }
+
+  void OnCompactionBegin(DB *db, const CompactionJobInfo &ci) override {
+    if (timeline_)
+      timeline_->OnCompactionBegin(ci);
+    Begin(running_compactions_);
+  }
 
   void OnCompactionCompleted(DB *db, const CompactionJobInfo &ci) override {
-    std::lock_guard lock(mtx);
-    compaction_complete = true;
-    cv.notify_one();
+    if (timeline_)
+      timeline_->OnCompactionCompleted(ci);
+    if (warmer_)
+      warmer_->OnCompactionCompleted(ci);
+    Complete(running_compactions_, num_compactions_);
   }
+
+  /**
+   * Blocks until the DB has no flush or compaction running or pending, and returns the seconds spent waiting.
+   * The DB properties decide whether work is left, since RocksDB schedules jobs before they begin; the events only
+   * wake the wait up, with max_poll as a fallback for work that becomes pending without one.
+   */
+  double WaitForQuiescence(DB *db, const std::chrono::milliseconds max_poll = std::chrono::milliseconds(100)) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock lock(mutex_);
+    while (true) {
+      const uint64_t events = num_events_;
+      lock.unlock();
+      const bool busy = HasBackgroundWork(db);
+      lock.lock();
+      if (!busy)
+        break;
+      cv_.wait_for(lock, max_poll, [this, events] { return num_events_ != events; });
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  [[nodiscard]] uint64_t NumFlushes() const {
+    std::lock_guard lock(mutex_);
+    return num_flushes_;
+  }
+
+  [[nodiscard]] uint64_t NumCompactions() const {
+    std::lock_guard lock(mutex_);
+    return num_compactions_;
+  }
+
+private:
+  static bool HasBackgroundWork(DB *db) {
+    uint64_t running_compactions = 0, running_flushes = 0, compaction_pending = 0, flush_pending = 0;
+    uint64_t pending_compaction_bytes = 0;
+    db->GetIntProperty(DB::Properties::kNumRunningCompactions, &running_compactions);
+    db->GetIntProperty(DB::Properties::kNumRunningFlushes, &running_flushes);
+    db->GetIntProperty(DB::Properties::kCompactionPending, &compaction_pending);
+    db->GetIntProperty(DB::Properties::kMemTableFlushPending, &flush_pending);
+    db->GetIntProperty(DB::Properties::kEstimatePendingCompactionBytes, &pending_compaction_bytes);
+    return running_compactions + running_flushes + compaction_pending + flush_pending + pending_compaction_bytes > 0;
+  }
+
+  void Begin(uint64_t& running) {
+    std::lock_guard lock(mutex_);
+    running++;
+    num_events_++;
+  }
+
+  void Complete(uint64_t& running, uint64_t& completed) {
+    bool idle;
+    {
+      std::lock_guard lock(mutex_);
+      running -= running > 0;
+      completed++;
+      num_events_++;
+      idle = running_flushes_ == 0 && running_compactions_ == 0;
+    }
+    // The wait only cares once nothing is running anymore
+    if (idle)
+      cv_.notify_all();
+  }
+
+  std::shared_ptr<EventTimeline> timeline_;
+  std::shared_ptr<CompactionWarmer> warmer_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t running_flushes_ = 0;
+  uint64_t running_compactions_ = 0;
+  uint64_t num_flushes_ = 0;
+  uint64_t num_compactions_ = 0;
+  uint64_t num_events_ = 0;
 };
 
-/** Waits for all compactions to complete. */
-inline void WaitForCompactions(DB *db) {
-  std::unique_lock lock(mtx);
-  uint64_t num_running_compactions;
-  uint64_t pending_compaction_bytes;
-  uint64_t num_pending_compactions;
+/** Lets the clients wait until all of them have arrived, for the range ops of a key hash partitioned workload */
+class ClientBarrier {
+public:
+  explicit ClientBarrier(const int num_clients) : num_clients_(num_clients) {}
 
-  while (!compaction_complete) {
-    db->GetIntProperty("rocksdb.num-running-compactions", &num_running_compactions);
-    db->GetIntProperty("rocksdb.estimate-pending-compaction-bytes", &pending_compaction_bytes);
-    db->GetIntProperty("rocksdb.compaction-pending", &num_pending_compactions);
+  void Wait() {
+    std::unique_lock lock(mutex_);
+    const uint64_t generation = generation_;
+    if (++arrived_ == num_clients_) {
+      arrived_ = 0;
+      generation_++;
+      cv_.notify_all();
+      return;
+    }
+    cv_.wait(lock, [this, generation] { return generation_ != generation; });
+  }
 
-    if (num_running_compactions == 0 && pending_compaction_bytes == 0 && num_pending_compactions == 0) {
-      break;
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int num_clients_;
+  int arrived_ = 0;
+  uint64_t generation_ = 0;
+};
+
+/** Consecutive point lookups collected for a single MultiGet */
+struct LookupBatch {
+  explicit LookupBatch(const size_t capacity) :
+    keys(capacity), key_buffers(capacity), values(capacity), statuses(capacity), line_nums(capacity) {}
+
+  std::vector<Slice> keys;
+  /** Copies of the keys, for readers whose slices do not outlive the next op */
+  std::vector<std::string> key_buffers;
+  std::vector<PinnableSlice> values;
+  std::vector<Status> statuses;
+  std::vector<uint64_t> line_nums;
+  size_t size = 0;
+};
+
+/**
+ * Block cache hits and misses of one kind of read, counted from the perf context of the client thread. The counts
+ * only need RocksDB's default perf level, kEnableCount, so they are kept with --stat 0 too. A miss is a block read
+ * from the file.
+ */
+struct ReadCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+
+  [[nodiscard]] double HitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0; }
+
+  void Merge(const ReadCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+  }
+};
+
+/**
+ * How the values of point lookups reached the client: pinned values point into the block cache or memtable, the
+ * others were copied into a buffer of the client. With verification, every value is also read through and hashed, as
+ * a client that uses its values would, and the hashes are summed so the total does not depend on the op order.
+ */
+struct ValueReadStats {
+  uint64_t pinned = 0;
+  uint64_t pinned_bytes = 0;
+  uint64_t copied = 0;
+  uint64_t copied_bytes = 0;
+  uint64_t checksum = 0;
+
+  void Record(const Slice& value, const bool is_pinned, const bool verify) {
+    (is_pinned ? pinned : copied)++;
+    (is_pinned ? pinned_bytes : copied_bytes) += value.size();
+    if (verify) {
+      uint64_t hash = 14695981039346656037ULL;
+      for (size_t i = 0; i < value.size(); i++)
+        hash = (hash ^ static_cast<unsigned char>(value[i])) * 1099511628211ULL;
+      checksum += hash;
     }
+  }
+
+  void Merge(const ValueReadStats& other) {
+    pinned += other.pinned;
+    pinned_bytes += other.pinned_bytes;
+    copied += other.copied;
+    copied_bytes += other.copied_bytes;
+    checksum += other.checksum;
+  }
+};
+
+/** Takes the perf context counters before a read and adds what the read did to the given stats */
+class ReadCacheScope {
+public:
+  explicit ReadCacheScope(ReadCacheStats& stats) :
+    stats_(stats), hits_(get_perf_context()->block_cache_hit_count), reads_(get_perf_context()->block_read_count) {}
+
+  ~ReadCacheScope() {
+    stats_.hits += get_perf_context()->block_cache_hit_count - hits_;
+    stats_.misses += get_perf_context()->block_read_count - reads_;
+  }
+
+private:
+  ReadCacheStats& stats_;
+  uint64_t hits_;
+  uint64_t reads_;
+};
+
+/** State owned by a single client thread replaying its share of the workload */
+struct WorkloadClient {
+  ReadOptions read_options;
+  ReadOptions multiget_read_options;
+  /** Read options of scans, whose iterate_upper_bound points to scan_upper_bound */
+  ReadOptions scan_read_options;
+  /** The end key of the current scan */
+  Slice scan_upper_bound;
+  /** The iterator of every scan under ScanIteratorPolicy::kReused */
+  std::unique_ptr<Iterator> scan_iterator;
+  uint64_t num_scanned_keys = 0;
+  /** Point lookups and scans are counted apart, so the damage scans do to the lookups' hit rate shows */
+  ReadCacheStats point_cache;
+  ReadCacheStats scan_cache;
+  /** The per-level perf context of the client thread, captured before the thread exits */
+  LevelCacheStatsMap level_cache;
+  /** The value of a point lookup under --pin_values, released right after the lookup so it never holds up eviction */
+  PinnableSlice pinned_value;
+  /** Reused across point lookups that copy their value out */
+  std::string value;
+  ValueReadStats value_reads;
+  /** The exclusive end key of a range delete, built from the inclusive end key in the workload */
+  std::string range_end;
+  std::unique_ptr<LookupBatch> lookup_batch;
+  uint64_t num_multiget_batches = 0;
+  WriteBatch write_batch;
+  /** The workload line of the first op in the write batch */
+  uint64_t write_batch_line_num = 0;
+  uint64_t num_write_batches = 0;
+  uint64_t num_range_deletes = 0;
+  /** Point lookups that found no value, e.g. zero-result lookups or keys removed by a range delete */
+  uint64_t num_not_found = 0;
+  /** Ops of a workload with timestamps that could only be issued over kLateMillis after their time */
+  uint64_t num_late_ops = 0;
+  /** Only written by the owning thread, but read by every client for the interval statistics */
+  alignas(64) std::atomic<uint64_t> num_ops = 0;
+  /** The range deletion reseeks of the thread's perf context, published at every logging interval */
+  std::atomic<uint64_t> range_del_reseeks = 0;
+  double seconds = 0;
+  OpLatencies latencies;
+};
+
+/** State shared by all the clients of a run */
+struct WorkloadRun {
+  WorkloadRun(const DBEnv& env, DB *db) : env(env), db(db), clients(env.num_threads), range_barrier(env.num_threads) {}
+
+  [[nodiscard]] uint64_t TotalOps() const {
+    uint64_t total_ops = 0;
+    for (const auto& client : clients)
+      total_ops += client.num_ops.load(std::memory_order_relaxed);
+    return total_ops;
+  }
 
-    cv.wait_for(lock, std::chrono::seconds(2));
+  [[nodiscard]] uint64_t TotalRangeDelReseeks() const {
+    uint64_t total_reseeks = 0;
+    for (const auto& client : clients)
+      total_reseeks += client.range_del_reseeks.load(std::memory_order_relaxed);
+    return total_reseeks;
+  }
+
+  const DBEnv& env;
+  DB *db;
+  WriteOptions write_options;
+  std::vector<WorkloadClient> clients;
+  /** Range ops wait for every client before they start and make every client wait until they are done */
+  ClientBarrier range_barrier;
+  /** When the replay started, the time the timestamps of a workload count from */
+  std::chrono::steady_clock::time_point start;
+  /** Written by whichever client passes the end of a logging interval first, if enabled */
+  std::unique_ptr<IntervalStats> intervals;
+  std::shared_ptr<CompactionsListener> compactions;
+  /** Samples the point lookup keys, if the compaction warm-up is enabled */
+  std::shared_ptr<CompactionWarmer> warmer;
+  /** The time between the end of the replay and the end of the last flush or compaction */
+  double compaction_wait_seconds = 0;
+};
+
+/** Issues the point lookups collected by the client as one MultiGet. */
+inline void FlushLookupBatch(const WorkloadRun& run, WorkloadClient& client) {
+  LookupBatch& batch = *client.lookup_batch;
+  if (batch.size == 0)
+    return;
+
+  std::chrono::steady_clock::time_point start;
+  if (run.env.record_latency)
+    start = std::chrono::steady_clock::now();
+
+  ReadCacheScope cache_scope(client.point_cache);
+  run.db->MultiGet(client.multiget_read_options, run.db->DefaultColumnFamily(), batch.size, batch.keys.data(),
+    batch.values.data(), batch.statuses.data());
+
+  if (run.env.record_latency) {
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    client.latencies.Record('M', nanos.count());
+  }
+
+  for (size_t i = 0; i < batch.size; i++) {
+    ASSERT(batch.statuses[i].ok() || batch.statuses[i].IsNotFound(),
+      batch.statuses[i].ToString() + " \nWorkload line: " + std::to_string(batch.line_nums[i]));
+    client.num_not_found += batch.statuses[i].IsNotFound();
+    if (batch.statuses[i].ok())
+      client.value_reads.Record(batch.values[i], batch.values[i].IsPinned(), run.env.verify_values);
+    batch.values[i].Reset();
+  }
+
+  client.num_multiget_batches++;
+  batch.size = 0;
+}
+
+/**
+ * The end key to pass to DeleteRange, which stops before it. An inclusive end key, as load_gen writes, becomes the
+ * smallest key after it in the client's range_end. An exclusive one, as traced from DeleteRange, is passed as is.
+ */
+inline Slice RangeDeleteEnd(WorkloadClient& client, const WorkloadOp& op) {
+  if (op.exclusive_end)
+    return op.end_key;
+  client.range_end.assign(op.end_key.data(), op.end_key.size());
+  client.range_end.push_back('\0');
+  return client.range_end;
+}
+
+/**
+ * Replays a scan over [key, end_key). The end key becomes the iterator's upper bound, so RocksDB stops at it
+ * (and skips blocks past it) without the loop comparing keys.
+ */
+inline void Scan(const WorkloadRun& run, WorkloadClient& client, const WorkloadOp& op) {
+  // Iterators keep a pointer to the bound, so a reused iterator sees the new end key on its next seek
+  client.scan_upper_bound = op.end_key;
+
+  std::unique_ptr<Iterator> scan_iterator;
+  Iterator *it = client.scan_iterator.get();
+  if (it != nullptr) {
+    it->Refresh();
+    ASSERT(it->status().ok(), it->status().ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+  } else {
+    scan_iterator.reset(run.db->NewIterator(client.scan_read_options));
+    it = scan_iterator.get();
+  }
+
+  for (it->Seek(op.key); it->Valid(); it->Next())
+    client.num_scanned_keys++;
+
+  ASSERT(it->status().ok(), it->status().ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+}
+
+/** Commits the writes grouped by the client as one WriteBatch. */
+inline void FlushWriteBatch(const WorkloadRun& run, WorkloadClient& client) {
+  if (client.write_batch.Count() == 0)
+    return;
+
+  std::chrono::steady_clock::time_point start;
+  if (run.env.record_latency)
+    start = std::chrono::steady_clock::now();
+
+  const Status s = run.db->Write(run.write_options, &client.write_batch);
+  ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(client.write_batch_line_num));
+
+  if (run.env.record_latency) {
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    client.latencies.Record('W', nanos.count());
+  }
+
+  client.num_write_batches++;
+  client.write_batch.Clear();
+}
+
+/** How far behind its time an op of a workload with timestamps has to be issued to count as late */
+constexpr int kLateMillis = 1;
+
+/**
+ * Sleeps until the time of an op of a workload with timestamps, scaled by the replay speed, and returns whether
+ * the op is already late, which means the DB does not keep up with the pace of the workload.
+ */
+inline bool WaitForOpTime(const WorkloadRun& run, const WorkloadOp& op) {
+  const auto due = run.start + std::chrono::microseconds(static_cast<int64_t>(op.timestamp / run.env.replay_speed));
+  const auto now = std::chrono::steady_clock::now();
+  if (due > now) {
+    std::this_thread::sleep_until(due);
+    return false;
+  }
+  return now - due > std::chrono::milliseconds(kLateMillis);
+}
+
+/** Replays the part of the workload that belongs to the given client. */
+inline void ReplayWorkload(WorkloadRun& run, const int id) {
+  const DBEnv& env = run.env;
+  DB *db = run.db;
+  const WriteOptions& write_options = run.write_options;
+  WorkloadClient& client = run.clients[id];
+
+  std::unique_ptr<WorkloadReader> workload = OpenWorkload(env.workload_file_path);
+  if (env.num_threads > 1) {
+    workload = std::make_unique<PartitionedWorkloadReader>(std::move(workload), env.workload_partitioning, id,
+      env.num_threads);
+  }
+
+  // Each client logs its own share, which keeps the total number of progress marks the same
+  const uint64_t log_interval = std::max(1, env.log_interval / env.num_threads);
+
+  // Consecutive point lookups are collected into a batch, which is flushed when it fills up or another op comes along
+  const bool batch_lookups = env.multiget_batch_size > 1;
+  const bool stable_keys = workload->HasStableSlices();
+  if (batch_lookups)
+    client.lookup_batch = std::make_unique<LookupBatch>(env.multiget_batch_size);
+
+  // Likewise, consecutive writes are grouped until the batch reaches its op or byte limit
+  const bool batch_writes = env.BatchWrites();
+  const auto write_batch_size = static_cast<uint32_t>(std::max(1, env.write_batch_size));
+
+  // Ops wait for their time before they are batched, so a batch goes out once its last op is due
+  const bool paced = env.replay_speed > 0 && workload->HasTimestamps();
+  if (id == 0 && env.replay_speed > 0 && !paced)
+    std::cout << "Note: the workload has no timestamps, --replay_speed is ignored" << std::endl;
+
+  client.scan_read_options.iterate_upper_bound = &client.scan_upper_bound;
+  if (env.scan_iterator_policy == ScanIteratorPolicy::kReused)
+    client.scan_iterator.reset(db->NewIterator(client.scan_read_options));
+
+  const auto start = std::chrono::steady_clock::now();
+  WorkloadOp op;
+  Status s;
+  while (workload->Next(op)) {
+    // The range op of another client, which has to see the writes before it and must not overlap the writes after it
+    if (op.barrier && !op.owned) {
+      if (batch_lookups)
+        FlushLookupBatch(run, client);
+      FlushWriteBatch(run, client);
+      run.range_barrier.Wait();
+      run.range_barrier.Wait();
+      continue;
+    }
+
+    const uint64_t num_ops = client.num_ops.load(std::memory_order_relaxed) + 1;
+    client.num_ops.store(num_ops, std::memory_order_relaxed);
+
+    // Print progress
+    if (num_ops % log_interval == 0) {
+      std::cout << "#" << std::flush;
+      if (run.intervals) {
+        client.range_del_reseeks.store(get_perf_context()->internal_range_del_reseek_count, std::memory_order_relaxed);
+        run.intervals->MaybeSnapshot(run.TotalOps(), run.TotalRangeDelReseeks());
+      }
+    }
+
+    if (paced)
+      client.num_late_ops += WaitForOpTime(run, op);
+
+    const bool is_write = op.instruction == 'I' || op.instruction == 'U' || op.instruction == 'D' || op.instruction == 'R';
+    client.num_range_deletes += op.instruction == 'R';
+    if (op.barrier) {
+      if (batch_lookups)
+        FlushLookupBatch(run, client);
+      FlushWriteBatch(run, client);
+      run.range_barrier.Wait();
+    } else if (batch_writes) {
+      if (is_write) {
+        if (batch_lookups)
+          FlushLookupBatch(run, client);
+        if (client.write_batch.Count() == 0)
+          client.write_batch_line_num = op.line_num;
+
+        if (op.instruction == 'R') {
+          s = client.write_batch.DeleteRange(op.key, RangeDeleteEnd(client, op));
+        } else {
+          s = op.instruction == 'D' ? client.write_batch.Delete(op.key) : client.write_batch.Put(op.key, op.value);
+        }
+        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+
+        if (client.write_batch.Count() >= write_batch_size ||
+            (env.write_batch_bytes > 0 && client.write_batch.GetDataSize() >= env.write_batch_bytes))
+          FlushWriteBatch(run, client);
+        continue;
+      }
+
+      FlushWriteBatch(run, client);
+    }
+
+    if (batch_lookups) {
+      LookupBatch& batch = *client.lookup_batch;
+      if (op.instruction == 'Q') {
+        if (stable_keys) {
+          batch.keys[batch.size] = op.key;
+        } else {
+          batch.key_buffers[batch.size].assign(op.key.data(), op.key.size());
+          batch.keys[batch.size] = batch.key_buffers[batch.size];
+        }
+        batch.line_nums[batch.size++] = op.line_num;
+        if (run.warmer && num_ops % CompactionWarmer::kLookupSampling == 0)
+          run.warmer->RecordLookup(op.key);
+
+        if (batch.size == batch.keys.size())
+          FlushLookupBatch(run, client);
+        continue;
+      }
+
+      FlushLookupBatch(run, client);
+    }
+
+    std::chrono::steady_clock::time_point op_start;
+    if (env.record_latency)
+      op_start = std::chrono::steady_clock::now();
+
+    switch (op.instruction) {
+      case 'I':  // Insert
+      case 'U':  // Update
+        s = db->Put(write_options, op.key, op.value);
+        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+        break;
+
+      case 'D':  // Delete
+        s = db->Delete(write_options, op.key);
+        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+        break;
+
+      case 'R':  // Range delete
+        s = db->DeleteRange(write_options, db->DefaultColumnFamily(), op.key, RangeDeleteEnd(client, op));
+        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+        break;
+
+      case 'Q': {  // Query
+        ReadCacheScope cache_scope(client.point_cache);
+        if (env.pin_values) {
+          s = db->Get(client.read_options, db->DefaultColumnFamily(), op.key, &client.pinned_value);
+          if (s.ok())
+            client.value_reads.Record(client.pinned_value, client.pinned_value.IsPinned(), env.verify_values);
+          client.pinned_value.Reset();
+        } else {
+          s = db->Get(client.read_options, op.key, &client.value);
+          if (s.ok())
+            client.value_reads.Record(client.value, false, env.verify_values);
+        }
+        ASSERT(s.ok() || s.IsNotFound(), s.ToString() + " \nWorkload line: " + std::to_string(op.line_num));
+        client.num_not_found += s.IsNotFound();
+        if (run.warmer && num_ops % CompactionWarmer::kLookupSampling == 0)
+          run.warmer->RecordLookup(op.key);
+        break;
+      }
+
+      case 'S': {  // Scan
+        ReadCacheScope cache_scope(client.scan_cache);
+        Scan(run, client, op);
+        break;
+      }
+
+      default:
+        std::cerr << "ERROR: Unknown workload instruction. Workload line: " << op.line_num << std::endl;
+        break;
+    }
+
+    if (env.record_latency) {
+      const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - op_start);
+      client.latencies.Record(op.instruction, nanos.count());
+    }
+
+    if (op.barrier)
+      run.range_barrier.Wait();
+  }
+
+  if (batch_lookups)
+    FlushLookupBatch(run, client);
+  if (batch_writes)
+    FlushWriteBatch(run, client);
+
+  client.scan_iterator.reset();
+  client.range_del_reseeks.store(get_perf_context()->internal_range_del_reseek_count, std::memory_order_relaxed);
+  client.level_cache = CaptureLevelCacheStats();
+  client.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** Prints the replay throughput and writes it next to the output file, along with the time writes spent stalled. */
+inline void ReportThroughput(const DBEnv& env, const WorkloadRun& run, const double seconds,
+  const std::shared_ptr<Statistics>& statistics) {
+  const std::vector<WorkloadClient>& clients = run.clients;
+  const uint64_t total_ops = run.TotalOps();
+  const double ops_per_sec = seconds > 0 ? total_ops / seconds : 0;
+  const uint64_t stall_micros = statistics ? statistics->getTickerCount(STALL_MICROS) : 0;
+
+  std::cout << "Replayed " << total_ops << " ops with " << clients.size() << " thread(s) in " << seconds << " s ("
+    << static_cast<uint64_t>(ops_per_sec) << " ops/sec)" << std::endl;
+  if (stall_micros > 0)
+    std::cout << "Writes were stalled for " << stall_micros / 1e6 << " s" << std::endl;
+  std::cout << "Waited " << run.compaction_wait_seconds << " s for background work after "
+    << run.compactions->NumFlushes() << " flushes and " << run.compactions->NumCompactions() << " compactions"
+    << std::endl;
+  const WarmupStats warmup = run.warmer ? run.warmer->Stats() : WarmupStats();
+  if (run.warmer) {
+    std::cout << "Warmed up " << warmup.files << " files of " << warmup.compactions << " compactions in "
+      << warmup.seconds << " s, reading " << warmup.metadata_bytes << " bytes of metadata and " << warmup.data_bytes
+      << " bytes for " << warmup.hot_keys << " hot keys" << std::endl;
+  }
+
+  ReadCacheStats point_cache, scan_cache;
+  ValueReadStats value_reads;
+  uint64_t num_late_ops = 0;
+  for (const auto& client : clients) {
+    point_cache.Merge(client.point_cache);
+    scan_cache.Merge(client.scan_cache);
+    value_reads.Merge(client.value_reads);
+    num_late_ops += client.num_late_ops;
+  }
+  if (value_reads.pinned + value_reads.copied > 0) {
+    std::cout << "Point lookup values: " << value_reads.pinned << " pinned (" << value_reads.pinned_bytes
+      << " bytes not copied), " << value_reads.copied << " copied (" << value_reads.copied_bytes << " bytes)";
+    if (env.verify_values)
+      std::cout << ", checksum " << value_reads.checksum;
+    std::cout << std::endl;
+  }
+  if (num_late_ops > 0) {
+    std::cout << num_late_ops << " ops were issued over " << kLateMillis << " ms after their time, the replay did not "
+      "keep up with the workload" << std::endl;
+  }
+  if (scan_cache.hits + scan_cache.misses > 0) {
+    std::cout << "Block cache hit rate: point lookups " << point_cache.HitRate() << ", scans " << scan_cache.HitRate()
+      << std::endl;
+  }
+
+  const std::string path = env.GetResultPath(".throughput.json");
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  ASSERT(file.is_open(), "Failed to open output file " + path);
+  file << "{\"threads\": " << clients.size()
+    << ", \"partitioning\": \""
+    << (env.workload_partitioning == WorkloadPartitioning::kRoundRobin ? "round_robin" : "key_hash") << "\""
+    << ", \"ops\": " << total_ops
+    << ", \"seconds\": " << seconds
+    << ", \"ops_per_sec\": " << ops_per_sec
+    << ", \"ops_per_sec_per_thread\": " << ops_per_sec / clients.size()
+    << ", \"multiget_batch_size\": " << env.multiget_batch_size
+    << ", \"write_batch_size\": " << env.write_batch_size
+    << ", \"write_batch_bytes\": " << env.write_batch_bytes
+    << ", \"stall_micros\": " << stall_micros
+    << ", \"flushes\": " << run.compactions->NumFlushes()
+    << ", \"compactions\": " << run.compactions->NumCompactions()
+    << ", \"compaction_wait_seconds\": " << run.compaction_wait_seconds
+    << ", \"warmup\": " << (run.warmer ? "true" : "false")
+    << ", \"warmup_compactions\": " << warmup.compactions
+    << ", \"warmup_files\": " << warmup.files
+    << ", \"warmup_failed_files\": " << warmup.failed_files
+    << ", \"warmup_budget_exhausted\": " << warmup.budget_exhausted
+    << ", \"warmup_metadata_bytes\": " << warmup.metadata_bytes
+    << ", \"warmup_hot_keys\": " << warmup.hot_keys
+    << ", \"warmup_data_bytes\": " << warmup.data_bytes
+    << ", \"warmup_seconds\": " << warmup.seconds
+    << ", \"point_cache_hits\": " << point_cache.hits
+    << ", \"point_cache_misses\": " << point_cache.misses
+    << ", \"point_cache_hit_rate\": " << point_cache.HitRate()
+    << ", \"scan_cache_hits\": " << scan_cache.hits
+    << ", \"scan_cache_misses\": " << scan_cache.misses
+    << ", \"scan_cache_hit_rate\": " << scan_cache.HitRate()
+    << ", \"pin_values\": " << (env.pin_values ? "true" : "false")
+    << ", \"pinned_values\": " << value_reads.pinned
+    << ", \"pinned_value_bytes\": " << value_reads.pinned_bytes
+    << ", \"copied_values\": " << value_reads.copied
+    << ", \"copied_value_bytes\": " << value_reads.copied_bytes
+    << ", \"value_checksum\": " << (env.verify_values ? std::to_string(value_reads.checksum) : "null")
+    << ", \"replay_speed\": " << env.replay_speed
+    << ", \"late_ops\": " << num_late_ops
+    << ", \"clients\": [";
+  for (size_t i = 0; i < clients.size(); i++) {
+    const auto& client = clients[i];
+    const uint64_t num_ops = client.num_ops.load();
+    file << (i > 0 ? ", " : "") << "{\"ops\": " << num_ops
+      << ", \"multiget_batches\": " << client.num_multiget_batches
+      << ", \"write_batches\": " << client.num_write_batches
+      << ", \"range_deletes\": " << client.num_range_deletes
+      << ", \"not_found\": " << client.num_not_found
+      << ", \"late_ops\": " << client.num_late_ops
+      << ", \"scanned_keys\": " << client.num_scanned_keys
+      << ", \"seconds\": " << client.seconds
+      << ", \"ops_per_sec\": " << (client.seconds > 0 ? num_ops / client.seconds : 0) << "}";
+  }
+  file << "]}" << std::endl;
+}
+
+/** Merges the latency histograms of all clients, prints them and writes them next to the output file. */
+inline void ReportLatencies(const DBEnv& env, const std::vector<WorkloadClient>& clients) {
+  OpLatencies latencies;
+  for (const auto& client : clients)
+    latencies.Merge(client.latencies);
+  latencies.Print(std::cout);
+
+  const std::string path = env.GetResultPath(".latency.json");
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  ASSERT(file.is_open(), "Failed to open output file " + path);
+  latencies.WriteJson(file);
+  file << std::endl;
+}
+
+/**
+ * Writes what the range deletes of the run left behind next to the output file: the tombstones in the live SST
+ * files and the memory of the table readers, which hold the fragmented range tombstones of every open file.
+ * The range deletion reseeks of the reads are in the perf context of the output file.
+ */
+inline void ReportRangeDeletions(const DBEnv& env, DB* db, const WorkloadRun& run) {
+  uint64_t num_range_deletes = 0;
+  for (const auto& client : run.clients)
+    num_range_deletes += client.num_range_deletes;
+
+  TablePropertiesCollection tables;
+  const Status s = db->GetPropertiesOfAllTables(&tables);
+  ASSERT(s.ok(), s.ToString());
+
+  uint64_t range_tombstones = 0, point_tombstones = 0, files_with_range_tombstones = 0;
+  for (const auto& [file, properties] : tables) {
+    range_tombstones += properties->num_range_deletions;
+    point_tombstones += properties->num_deletions - properties->num_range_deletions;
+    files_with_range_tombstones += properties->num_range_deletions > 0;
+  }
+
+  uint64_t table_readers_memory = 0;
+  db->GetIntProperty(DB::Properties::kEstimateTableReadersMem, &table_readers_memory);
+
+  std::cout << "Replayed " << num_range_deletes << " range deletes, " << range_tombstones << " range tombstones in "
+    << files_with_range_tombstones << " of " << tables.size() << " files" << std::endl;
+
+  const std::string path = env.GetResultPath(".range_deletions.json");
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  ASSERT(file.is_open(), "Failed to open output file " + path);
+  file << "{\"range_deletes\": " << num_range_deletes
+    << ", \"ignore_range_deletions\": " << (env.ignore_range_deletions ? "true" : "false")
+    << ", \"files\": " << tables.size()
+    << ", \"files_with_range_tombstones\": " << files_with_range_tombstones
+    << ", \"range_tombstones\": " << range_tombstones
+    << ", \"point_tombstones\": " << point_tombstones
+    << ", \"table_readers_memory\": " << table_readers_memory << "}" << std::endl;
+}
+
+/**
+ * Prints how lookups split between the primary and the compressed secondary cache and writes it next to the
+ * output file. The tiered cache hands out a handle for a hit in the secondary cache, so the table reader counts it
+ * as a block cache hit too: BLOCK_CACHE_HIT is the hits of both tiers, and BLOCK_CACHE_MISS the blocks read.
+ */
+inline void ReportCacheTiers(const DBEnv& env, const std::shared_ptr<Statistics>& statistics) {
+  const uint64_t cache_hits = statistics->getTickerCount(BLOCK_CACHE_HIT);
+  const uint64_t cache_misses = statistics->getTickerCount(BLOCK_CACHE_MISS);
+  const uint64_t secondary_hits = std::min(statistics->getTickerCount(SECONDARY_CACHE_HITS), cache_hits);
+  const uint64_t compressed_secondary_hits = statistics->getTickerCount(COMPRESSED_SECONDARY_CACHE_HITS);
+  const uint64_t primary_hits = cache_hits - secondary_hits;
+  const uint64_t primary_misses = secondary_hits + cache_misses;
+  const uint64_t lookups = cache_hits + cache_misses;
+
+  const double primary_hit_rate = lookups > 0 ? static_cast<double>(primary_hits) / lookups : 0;
+  const double secondary_hit_rate = primary_misses > 0 ? static_cast<double>(secondary_hits) / primary_misses : 0;
+  const double combined_hit_rate = lookups > 0 ? static_cast<double>(cache_hits) / lookups : 0;
+
+  std::cout << "Block cache hit rate: primary " << primary_hit_rate << ", secondary " << secondary_hit_rate
+    << " of primary misses, combined " << combined_hit_rate << std::endl;
+
+  const std::string path = env.GetResultPath(".cache_tiers.json");
+  std::ofstream file(path, std::ios::out | std::ios::trunc);
+  ASSERT(file.is_open(), "Failed to open output file " + path);
+  file << "{\"primary_capacity\": " << env.capacity
+    << ", \"secondary_capacity\": " << env.secondary_cache_capacity
+    << ", \"lookups\": " << lookups
+    << ", \"primary_hits\": " << primary_hits
+    << ", \"secondary_hits\": " << secondary_hits
+    << ", \"compressed_secondary_hits\": " << compressed_secondary_hits
+    << ", \"primary_hit_rate\": " << primary_hit_rate
+    << ", \"secondary_hit_rate\": " << secondary_hit_rate
+    << ", \"combined_hit_rate\": " << combined_hit_rate << "}" << std::endl;
+}
+
+/**
+ * Starts recording the query trace and the block cache trace of the replay, if enabled. import_trace turns either
+ * into a workload again, so the traces of one configuration can be replayed against another.
+ */
+inline void StartTraces(const DBEnv& env, DB *db) {
+  if (!env.trace_file_path.empty()) {
+    std::unique_ptr<TraceWriter> trace_writer;
+    Status s = NewFileTraceWriter(Env::Default(), EnvOptions(), env.trace_file_path, &trace_writer);
+    ASSERT(s.ok(), "Failed to open trace file " + env.trace_file_path + ": " + s.ToString());
+    TraceOptions trace_options;
+    trace_options.sampling_frequency = env.trace_sampling;
+    s = db->StartTrace(trace_options, std::move(trace_writer));
+    ASSERT(s.ok(), s.ToString());
+  }
+
+  if (!env.block_cache_trace_file_path.empty()) {
+    std::unique_ptr<TraceWriter> trace_writer;
+    Status s = NewFileTraceWriter(Env::Default(), EnvOptions(), env.block_cache_trace_file_path, &trace_writer);
+    ASSERT(s.ok(), "Failed to open trace file " + env.block_cache_trace_file_path + ": " + s.ToString());
+    std::unique_ptr<BlockCacheTraceWriter> block_cache_trace_writer;
+    s = NewBlockCacheTraceWriter(SystemClock::Default().get(), BlockCacheTraceWriterOptions(), std::move(trace_writer),
+      &block_cache_trace_writer);
+    ASSERT(s.ok(), s.ToString());
+    BlockCacheTraceOptions trace_options;
+    trace_options.sampling_frequency = env.trace_sampling;
+    s = db->StartBlockCacheTrace(trace_options, std::move(block_cache_trace_writer));
+    ASSERT(s.ok(), s.ToString());
+  }
+}
+
+/** Stops the traces started by StartTraces, which flushes them to their files. */
+inline void EndTraces(const DBEnv& env, DB *db) {
+  if (!env.trace_file_path.empty()) {
+    const Status s = db->EndTrace();
+    ASSERT(s.ok(), s.ToString());
+    std::cout << "Query trace written to " << env.trace_file_path << std::endl;
+  }
+
+  if (!env.block_cache_trace_file_path.empty()) {
+    const Status s = db->EndBlockCacheTrace();
+    ASSERT(s.ok(), s.ToString());
+    std::cout << "Block cache trace written to " << env.block_cache_trace_file_path << std::endl;
   }
 }
 
@@ -74,7 +869,10 @@ inline bool RunWorkload(DBEnv& env) {
 
   options.table_factory.reset(NewBlockBasedTableFactory(table_options));
 
-  if (env.destroy_database) {
+  if (!env.from_checkpoint.empty()) {
+    DestroyDB(env.db_path, options);
+    CloneDatabase(env.from_checkpoint, env.db_path);
+  } else if (env.destroy_database) {
     std::cout << "Destroying database..." << std::endl;
     DestroyDB(env.db_path, options);
   }
@@ -95,83 +893,112 @@ inline bool RunWorkload(DBEnv& env) {
 
   PrintExperimentalSetup(env);
 
-  auto compaction_listener = std::make_shared<CompactionsListener>();
+  // Started before the DB is opened so recovery flushes are on it too, the intervals share its clock
+  std::shared_ptr<EventTimeline> timeline;
+  if (env.event_window_millis > 0) {
+    timeline = std::make_shared<EventTimeline>(options.statistics,
+      std::chrono::milliseconds(std::max(1, env.event_window_millis / 10)));
+  }
+  std::shared_ptr<CompactionWarmer> warmer;
+  if (env.compaction_warmup) {
+    warmer = std::make_shared<CompactionWarmer>(options, static_cast<uint64_t>(env.warmup_budget_mb) << 20,
+      env.warmup_hot_keys);
+  }
+  auto compaction_listener = std::make_shared<CompactionsListener>(timeline, warmer);
   options.listeners.emplace_back(compaction_listener);
 
   DB* db;
   Status s = DB::Open(options, env.db_path, &db);
   ASSERT(s.ok(), s.ToString());
 
-  std::ifstream workload_file(env.workload_file_path);
-  ASSERT(workload_file.is_open(), "Failed to open workload file " + env.workload_file_path);
-
-  auto it = db->NewIterator(read_options);
-  int line_num = 1;
-  char instruction;
-  while (workload_file >> instruction) {
-    std::string key, start_key, end_key, value;
+  if (env.num_threads > 1 && env.enable_perf_iostat) {
+    std::cout << "Note: perf and iostat contexts are per thread, the output file only covers client 0" << std::endl;
+  }
 
-    // Print progress
-    if (line_num % env.log_interval == 0) {
-      std::cout << "#" << std::flush;
+  WorkloadRun run(env, db);
+  run.compactions = compaction_listener;
+  run.warmer = warmer;
+  run.write_options = write_options;
+  for (auto& client : run.clients) {
+    client.read_options = read_options;
+    client.multiget_read_options = read_options;
+    client.multiget_read_options.async_io = env.multiget_async_io;
+    configureScanReadOptions(env, client.scan_read_options);
+  }
+  std::unique_ptr<CacheOccupancySampler> cache_sampler;
+  if (env.record_intervals) {
+    run.intervals = std::make_unique<IntervalStats>(env.GetResultPath(".intervals.csv"), db, options.statistics,
+      env.log_interval);
+    if (env.cache_sample_millis > 0 && table_options.block_cache) {
+      const bool metadata_in_high_priority_pool = env.cache_index_and_filter_blocks_with_high_priority
+        && env.cache_type == CacheType::kLRU && env.cache_high_priority_ratio > 0;
+      cache_sampler = std::make_unique<CacheOccupancySampler>(table_options.block_cache,
+        std::chrono::milliseconds(env.cache_sample_millis), metadata_in_high_priority_pool);
+      run.intervals->SetCacheSampler(cache_sampler.get());
     }
+    run.intervals->Start(timeline ? timeline->StartTime() : std::chrono::steady_clock::now());
+  }
 
-    switch (instruction) {
-      case 'I':  // Insert
-      case 'U':  // Update
-        workload_file >> key >> value;
-        s = db->Put(write_options, key, value);
-        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(line_num));
-        break;
-
-      case 'D':  // Delete
-        workload_file >> key;
-        s = db->Delete(write_options, key);
-        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(line_num));
-        break;
-
-      case 'Q':  // Query
-        workload_file >> key;
-        s = db->Get(read_options, key, &value);
-        ASSERT(s.ok(), s.ToString() + " \nWorkload line: " + std::to_string(line_num));
-        break;
-
-      case 'S':  // Scan
-        workload_file >> start_key >> end_key;
-        it->Refresh();
-        ASSERT(it->status().ok(), it->status().ToString() + " \nWorkload line: " + std::to_string(line_num));
-
-        for (it->Seek(start_key); it->Valid(); it->Next()) {
-          if (it->key().ToString() >= end_key) {
-            break;
-          }
-        }
-
-        ASSERT(it->status().ok(), it->status().ToString() + " \nWorkload line: " + std::to_string(line_num));
-
-        break;
+  StartTraces(env, db);
 
-      default:
-        std::cerr << "ERROR: Unknown workload instruction. Workload line: " << line_num << std::endl;
-        break;
-    }
-
-    line_num++;
+  // The calling thread is client 0, so the thread-local perf and iostat contexts cover the single-threaded case fully
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  run.start = start;
+  for (int id = 1; id < env.num_threads; id++) {
+    threads.emplace_back([&run, id] {
+      if (run.env.enable_perf_iostat) {
+        SetPerfLevel(kEnableTimeAndCPUTimeExceptForMutex);
+        get_perf_context()->EnablePerLevelPerfContext();
+      }
+      ReplayWorkload(run, id);
+    });
   }
+  ReplayWorkload(run, 0);
+  for (auto& thread : threads)
+    thread.join();
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EndTraces(env, db);
 
-  delete it;
-  workload_file.close();
+  if (run.intervals) {
+    run.intervals->Snapshot(run.TotalOps(), run.TotalRangeDelReseeks());
+    run.intervals.reset();
+    cache_sampler.reset();
+  }
 
   std::vector<std::string> live_files;
   uint64_t manifest_size;
   db->GetLiveFiles(live_files, &manifest_size, true);
-  WaitForCompactions(db);
+  run.compaction_wait_seconds = compaction_listener->WaitForQuiescence(db);
+  if (warmer)
+    warmer->Stop();
+
+  if (std::any_of(run.clients.begin(), run.clients.end(), [](const auto& client) { return client.num_range_deletes > 0; }))
+    ReportRangeDeletions(env, db, run);
 
   s = db->Close();
   ASSERT(s.ok(), s.ToString());
 
   std::cout << " End of experiment - TEST!!" << std::endl;
 
+  if (timeline)
+    timeline->Write(env.GetResultPath(".events.csv"), std::chrono::milliseconds(env.event_window_millis));
+
+  ReportThroughput(env, run, seconds, options.statistics);
+  if (env.record_latency)
+    ReportLatencies(env, run.clients);
+  if (env.secondary_cache_capacity > 0 && options.statistics)
+    ReportCacheTiers(env, options.statistics);
+
+  if (options.statistics) {
+    LevelCacheStatsMap level_cache;
+    for (const auto& client : run.clients) {
+      for (const auto& [level, stats] : client.level_cache)
+        level_cache[level].Merge(stats);
+    }
+    WriteCacheStats(env.GetResultPath(".cache_stats.json"), options.statistics, level_cache);
+  }
+
   if (env.enable_perf_iostat) {
     std::ofstream output_file(env.output_file_path, std::ios::out | std::ios::trunc);
     ASSERT(output_file.is_open(), "Failed to open output file " + env.output_file_path);
@@ -199,6 +1026,7 @@ inline void PrintExperimentalSetup(const DBEnv& env) {
     << std::setw(l) << "M"
     << std::setw(l) << "L1_size"
     << std::setw(l) << "blk_cch"
+    << std::setw(l) << "cch_type"
     << std::setw(l) << "bpk"
     << "\n";
 
@@ -211,6 +1039,7 @@ inline void PrintExperimentalSetup(const DBEnv& env) {
     << std::setw(l) << env.GetBufferSize()
     << std::setw(l) << env.GetMaxBytesForLevelBase()
     << std::setw(l) << env.capacity
+    << std::setw(l) << static_cast<int>(env.cache_type)
     << std::setw(l) << env.bits_per_key
     << std::endl;
 }
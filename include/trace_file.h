@@ -0,0 +1,410 @@
+#pragma once
+
+#include <rocksdb/db.h>
+#include <rocksdb/env.h>
+#include <rocksdb/options.h>
+#include <rocksdb/table_reader_caller.h>
+#include <rocksdb/trace_reader_writer.h>
+#include <rocksdb/trace_record.h>
+#include <rocksdb/utilities/replayer.h>
+#include <rocksdb/write_batch.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "workload_file.h"
+
+#include "ASSERT_message.h"
+
+/**
+ * Readers that turn the trace files RocksDB writes into workload ops, so captures of real traffic can be replayed
+ * like a generated workload. The timestamp of every op is the microseconds since the first record of the trace.
+ *
+ * A query trace (DB::StartTrace) has every Get, MultiGet, write batch and iterator seek the DB was asked for.
+ * A block cache trace (DB::StartBlockCacheTrace) only has the block lookups, from which the point lookups that
+ * reached the SST files can be recovered, but not the ones served by the memtables, nor the writes and scans.
+ */
+
+/** What a trace reader could not turn into workload ops */
+struct TraceImportStats {
+  uint64_t records = 0;
+  uint64_t ops = 0;
+  /** Seeks without an upper bound, and SeekForPrev, have no end key that a scan could stop at */
+  uint64_t skipped_seeks = 0;
+  uint64_t skipped_merges = 0;
+  /** Block cache lookups of compactions, flushes and iterators, which are not point lookups of a client */
+  uint64_t skipped_block_lookups = 0;
+  /** Block lookups of a Get or MultiGet whose referenced key was not recorded */
+  uint64_t skipped_empty_keys = 0;
+  uint64_t skipped_other = 0;
+};
+
+/** Owns the key and argument of an op expanded from a trace record, which can hold several ops */
+struct TraceOp {
+  char instruction = 0;
+  std::string key;
+  std::string arg;
+  uint64_t timestamp = 0;
+  bool exclusive_end = false;
+};
+
+/** Hands out the ops expanded from trace records one at a time */
+class TraceWorkloadReader : public WorkloadReader {
+public:
+  bool Next(WorkloadOp& op) override {
+    while (next_op_ == ops_.size()) {
+      ops_.clear();
+      next_op_ = 0;
+      if (!ReadRecord())
+        return false;
+      stats_.records++;
+    }
+
+    const TraceOp& trace_op = ops_[next_op_++];
+    op.instruction = trace_op.instruction;
+    op.line_num = ++line_num_;
+    op.key = trace_op.key;
+    op.value = op.end_key = rocksdb::Slice();
+    if (op.instruction == 'I' || op.instruction == 'U')
+      op.value = trace_op.arg;
+    else if (op.instruction == 'S' || op.instruction == 'R')
+      op.end_key = trace_op.arg;
+    op.exclusive_end = trace_op.exclusive_end;
+    op.timestamp = trace_op.timestamp;
+    stats_.ops++;
+    return true;
+  }
+
+  [[nodiscard]] bool HasTimestamps() const override { return true; }
+
+  [[nodiscard]] const TraceImportStats& Stats() const { return stats_; }
+
+protected:
+  /** Expands the next record of the trace into ops with Add, returning false at the end of the trace */
+  virtual bool ReadRecord() = 0;
+
+  void Add(const char instruction, const rocksdb::Slice& key, const rocksdb::Slice& arg, const uint64_t micros,
+    const bool exclusive_end = false) {
+    if (first_micros_ == UINT64_MAX)
+      first_micros_ = micros;
+    TraceOp& op = ops_.emplace_back();
+    op.instruction = instruction;
+    op.key.assign(key.data(), key.size());
+    op.arg.assign(arg.data(), arg.size());
+    op.timestamp = micros > first_micros_ ? micros - first_micros_ : 0;
+    op.exclusive_end = exclusive_end;
+  }
+
+  TraceImportStats stats_;
+
+private:
+  std::vector<TraceOp> ops_;
+  size_t next_op_ = 0;
+  uint64_t line_num_ = 0;
+  uint64_t first_micros_ = UINT64_MAX;
+};
+
+/**
+ * Reads a query trace through RocksDB's replayer, which decodes the records of every trace format version without
+ * executing them. The replayer has to belong to a DB, so an empty scratch DB is opened next to the trace for it.
+ * Column families are not kept apart, every op goes to the default column family of the run.
+ */
+class QueryTraceWorkloadReader final : public TraceWorkloadReader {
+public:
+  explicit QueryTraceWorkloadReader(const std::string& path) : scratch_path_(path + ".import_db") {
+    rocksdb::Env* fs = rocksdb::Env::Default();
+    std::unique_ptr<rocksdb::TraceReader> trace_reader;
+    rocksdb::Status s = rocksdb::NewFileTraceReader(fs, rocksdb::EnvOptions(), path, &trace_reader);
+    ASSERT(s.ok(), "Failed to open trace file " + path + ": " + s.ToString());
+
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    rocksdb::DestroyDB(scratch_path_, options);
+    s = rocksdb::DB::Open(options, scratch_path_, &scratch_db_);
+    ASSERT(s.ok(), "Failed to open scratch DB " + scratch_path_ + ": " + s.ToString());
+
+    s = scratch_db_->NewDefaultReplayer({scratch_db_->DefaultColumnFamily()}, std::move(trace_reader), &replayer_);
+    ASSERT(s.ok(), s.ToString());
+    s = replayer_->Prepare();
+    ASSERT(s.ok(), "Not a query trace " + path + ": " + s.ToString());
+  }
+
+  ~QueryTraceWorkloadReader() override {
+    replayer_.reset();
+    scratch_db_->Close();
+    delete scratch_db_;
+    rocksdb::DestroyDB(scratch_path_, rocksdb::Options());
+    std::filesystem::remove_all(scratch_path_);
+  }
+
+protected:
+  bool ReadRecord() override {
+    std::unique_ptr<rocksdb::TraceRecord> record;
+    const rocksdb::Status s = replayer_->Next(&record);
+    // The trace ends with an end record, or just stops if the DB was not closed cleanly
+    if (s.IsIncomplete())
+      return false;
+    if (s.IsNotSupported()) {
+      stats_.skipped_other++;
+      return true;
+    }
+    ASSERT(s.ok(), "Failed to read the query trace: " + s.ToString());
+
+    const uint64_t micros = record->GetTimestamp();
+    switch (record->GetTraceType()) {
+      case rocksdb::kTraceWrite: {
+        const auto& write = static_cast<const rocksdb::WriteQueryTraceRecord&>(*record);
+        rocksdb::WriteBatch batch(write.GetWriteBatchRep().ToString());
+        WriteBatchOps handler(*this, micros);
+        const rocksdb::Status batch_status = batch.Iterate(&handler);
+        ASSERT(batch_status.ok(), "Failed to read a traced write batch: " + batch_status.ToString());
+        break;
+      }
+
+      case rocksdb::kTraceGet: {
+        const auto& get = static_cast<const rocksdb::GetQueryTraceRecord&>(*record);
+        Add('Q', get.GetKey(), rocksdb::Slice(), micros);
+        break;
+      }
+
+      case rocksdb::kTraceMultiGet: {
+        const auto& multiget = static_cast<const rocksdb::MultiGetQueryTraceRecord&>(*record);
+        for (const auto& key : multiget.GetKeys())
+          Add('Q', key, rocksdb::Slice(), micros);
+        break;
+      }
+
+      case rocksdb::kTraceIteratorSeek:
+      case rocksdb::kTraceIteratorSeekForPrev: {
+        const auto& seek = static_cast<const rocksdb::IteratorSeekQueryTraceRecord&>(*record);
+        if (seek.GetSeekType() == rocksdb::IteratorSeekQueryTraceRecord::kSeek && !seek.GetUpperBound().empty())
+          Add('S', seek.GetKey(), seek.GetUpperBound(), micros);
+        else
+          stats_.skipped_seeks++;
+        break;
+      }
+
+      default:
+        stats_.skipped_other++;
+        break;
+    }
+    return true;
+  }
+
+private:
+  /**
+   * Turns the entries of a traced write batch into ops. Puts become inserts, which the runner replays the same way
+   * as updates. The end key of a range delete is exclusive in RocksDB but inclusive in the workload, so the replay
+   * also deletes the end key itself.
+   */
+  class WriteBatchOps final : public rocksdb::WriteBatch::Handler {
+  public:
+    WriteBatchOps(QueryTraceWorkloadReader& reader, const uint64_t micros) : reader_(reader), micros_(micros) {}
+
+    rocksdb::Status PutCF(uint32_t, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+      reader_.Add('I', key, value, micros_);
+      return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteCF(uint32_t, const rocksdb::Slice& key) override {
+      reader_.Add('D', key, rocksdb::Slice(), micros_);
+      return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status SingleDeleteCF(uint32_t, const rocksdb::Slice& key) override {
+      reader_.Add('D', key, rocksdb::Slice(), micros_);
+      return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteRangeCF(uint32_t, const rocksdb::Slice& begin_key, const rocksdb::Slice& end_key) override {
+      // DeleteRange stops before the end key, so it is replayed as an exclusive end
+      reader_.Add('R', begin_key, end_key, micros_, true);
+      return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status MergeCF(uint32_t, const rocksdb::Slice&, const rocksdb::Slice&) override {
+      reader_.stats_.skipped_merges++;
+      return rocksdb::Status::OK();
+    }
+
+    void LogData(const rocksdb::Slice&) override {}
+
+  private:
+    QueryTraceWorkloadReader& reader_;
+    uint64_t micros_;
+  };
+
+  std::string scratch_path_;
+  rocksdb::DB *scratch_db_ = nullptr;
+  std::unique_ptr<rocksdb::Replayer> replayer_;
+};
+
+/**
+ * Reads a block cache trace, whose records RocksDB has no public reader for, and turns the block lookups of every
+ * Get and MultiGet into one point lookup of the key they were for. A lookup touches the filter, index and data
+ * blocks of every file it checks, all under the same get id, so only the first block lookup of an id becomes an op.
+ *
+ * A record is the encoded trace of trace_record.h (timestamp, type, payload length, payload) with the payload
+ *
+ *   block_key | block_size (fixed64) | cf_id (fixed64) | cf_name | level (fixed32) | sst_fd_number (fixed64) |
+ *   caller | is_cache_hit | no_insert | [get_id (fixed64) | get_from_user_specified_snapshot | referenced_key] | ...
+ *
+ * where the strings are prefixed with a varint32 length, and the get fields are only there for Get and MultiGet.
+ */
+class BlockCacheTraceWorkloadReader final : public TraceWorkloadReader {
+public:
+  explicit BlockCacheTraceWorkloadReader(const std::string& path) {
+    const rocksdb::Status s = rocksdb::NewFileTraceReader(rocksdb::Env::Default(), rocksdb::EnvOptions(), path,
+      &trace_reader_);
+    ASSERT(s.ok(), "Failed to open trace file " + path + ": " + s.ToString());
+
+    // The header record holds the magic and the version of the block cache trace format
+    uint64_t micros;
+    char type;
+    rocksdb::Slice payload;
+    const bool has_header = ReadTrace(&micros, &type, &payload);
+    ASSERT(has_header && type == rocksdb::kTraceBegin, "Not a block cache trace " + path);
+  }
+
+protected:
+  bool ReadRecord() override {
+    uint64_t micros;
+    char type;
+    rocksdb::Slice payload;
+    if (!ReadTrace(&micros, &type, &payload) || type == rocksdb::kTraceEnd)
+      return false;
+
+    switch (type) {
+      case rocksdb::kBlockTraceIndexBlock:
+      case rocksdb::kBlockTraceFilterBlock:
+      case rocksdb::kBlockTraceDataBlock:
+      case rocksdb::kBlockTraceUncompressionDictBlock:
+      case rocksdb::kBlockTraceRangeDeletionBlock:
+        break;
+      default:
+        stats_.skipped_other++;
+        return true;
+    }
+
+    rocksdb::Slice block_key, cf_name, referenced_key;
+    uint64_t block_size, cf_id, sst_fd_number, get_id;
+    uint32_t level;
+    char caller, is_cache_hit, no_insert, from_snapshot;
+    bool valid = GetLengthPrefixed(&payload, &block_key) && GetFixed64(&payload, &block_size) &&
+      GetFixed64(&payload, &cf_id) && GetLengthPrefixed(&payload, &cf_name) && GetFixed32(&payload, &level) &&
+      GetFixed64(&payload, &sst_fd_number) && GetByte(&payload, &caller) && GetByte(&payload, &is_cache_hit) &&
+      GetByte(&payload, &no_insert);
+    ASSERT(valid, "Corrupted block cache trace record " + std::to_string(stats_.records + 1));
+
+    if (caller != rocksdb::TableReaderCaller::kUserGet && caller != rocksdb::TableReaderCaller::kUserMultiGet) {
+      stats_.skipped_block_lookups++;
+      return true;
+    }
+    valid = GetFixed64(&payload, &get_id) && GetByte(&payload, &from_snapshot) &&
+      GetLengthPrefixed(&payload, &referenced_key);
+    ASSERT(valid, "Corrupted block cache trace record " + std::to_string(stats_.records + 1));
+
+    // The referenced key is an internal key, the user key followed by the sequence number and type
+    if (referenced_key.size() >= kInternalKeyFooterSize)
+      referenced_key.remove_suffix(kInternalKeyFooterSize);
+    if (referenced_key.empty()) {
+      stats_.skipped_empty_keys++;
+      return true;
+    }
+
+    // A Get looks up one key in several blocks, under one get id. All keys of a MultiGet share its get id too, so
+    // each key of a MultiGet is a query of its own.
+    const auto [lookup, new_get_id] = seen_lookups_.try_emplace(get_id);
+    if (caller == rocksdb::TableReaderCaller::kUserMultiGet) {
+      if (!lookup->second.insert(referenced_key.ToString()).second)
+        return true;
+    } else if (!new_get_id) {
+      return true;
+    }
+    // Get ids only grow, apart from concurrent lookups, so the ids far behind the newest ones can be forgotten
+    if (seen_lookups_.size() > kMaxSeenGetIds) {
+      const uint64_t newest = std::max_element(seen_lookups_.begin(), seen_lookups_.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; })->first;
+      for (auto it = seen_lookups_.begin(); it != seen_lookups_.end();)
+        it = newest - it->first > kMaxSeenGetIds / 2 ? seen_lookups_.erase(it) : std::next(it);
+    }
+
+    Add('Q', referenced_key, rocksdb::Slice(), micros);
+    return true;
+  }
+
+private:
+  static constexpr size_t kTraceMetadataSize = sizeof(uint64_t) + 1 + sizeof(uint32_t);
+  static constexpr size_t kInternalKeyFooterSize = 8;
+  static constexpr size_t kMaxSeenGetIds = 1 << 20;
+
+  /** Reads the next encoded trace, false at the end of the file */
+  bool ReadTrace(uint64_t *micros, char *type, rocksdb::Slice *payload) {
+    const rocksdb::Status s = trace_reader_->Read(&record_);
+    if (s.IsIncomplete())
+      return false;
+    ASSERT(s.ok(), "Failed to read the block cache trace: " + s.ToString());
+    ASSERT(record_.size() >= kTraceMetadataSize, "Truncated block cache trace record");
+
+    *micros = WorkloadFormat::DecodeFixed64(record_.data());
+    *type = record_[sizeof(uint64_t)];
+    const uint32_t length = WorkloadFormat::DecodeFixed32(record_.data() + sizeof(uint64_t) + 1);
+    ASSERT(record_.size() >= kTraceMetadataSize + length, "Truncated block cache trace record");
+    *payload = rocksdb::Slice(record_.data() + kTraceMetadataSize, length);
+    return true;
+  }
+
+  static bool GetByte(rocksdb::Slice *input, char *value) {
+    if (input->empty())
+      return false;
+    *value = (*input)[0];
+    input->remove_prefix(1);
+    return true;
+  }
+
+  static bool GetFixed32(rocksdb::Slice *input, uint32_t *value) {
+    if (input->size() < sizeof(uint32_t))
+      return false;
+    *value = WorkloadFormat::DecodeFixed32(input->data());
+    input->remove_prefix(sizeof(uint32_t));
+    return true;
+  }
+
+  static bool GetFixed64(rocksdb::Slice *input, uint64_t *value) {
+    if (input->size() < sizeof(uint64_t))
+      return false;
+    *value = WorkloadFormat::DecodeFixed64(input->data());
+    input->remove_prefix(sizeof(uint64_t));
+    return true;
+  }
+
+  static bool GetLengthPrefixed(rocksdb::Slice *input, rocksdb::Slice *value) {
+    uint32_t length = 0;
+    for (int shift = 0; shift <= 28; shift += 7) {
+      char byte;
+      if (!GetByte(input, &byte))
+        return false;
+      length |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        if (input->size() < length)
+          return false;
+        *value = rocksdb::Slice(input->data(), length);
+        input->remove_prefix(length);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::unique_ptr<rocksdb::TraceReader> trace_reader_;
+  std::string record_;
+  /** The get ids seen so far, with the keys already queried for the ones of a MultiGet */
+  std::unordered_map<uint64_t, std::unordered_set<std::string>> seen_lookups_;
+};
@@ -0,0 +1,498 @@
+#pragma once
+
+#include <rocksdb/slice.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ASSERT_message.h"
+
+/**
+ * Workloads come in two formats. The text format is the one emitted by load_gen, one instruction per line:
+ *
+ *   I <key> <value>, U <key> <value>, D <key>, Q <key>, S <start_key> <end_key>, R <start_key> <end_key>
+ *
+ * The binary format holds the same instructions in a compact form that can be replayed straight out of an mmap.
+ * It starts with a header (magic, version, number of ops, key width, flags), followed by one record per op:
+ *
+ *   op (1 byte) | [timestamp (fixed64)] | key_len (fixed32) | key | [arg_len (fixed32) | arg]
+ *
+ * where arg is the value for I/U and the end key for S/R. The end key of R is inclusive, unless the op byte has
+ * OP_EXCLUSIVE_END set, as for the range deletes of an imported trace. All integers are little-endian. With a key
+ * width, keys and end keys are stored as exactly that many bytes without a length, typically the fixed-width big-endian
+ * binary keys of KeyCodec.h. With FLAG_TIMESTAMPS, every op carries the microseconds since the start of the workload,
+ * e.g. the arrival times of an imported trace. Version 1 files have no key width and version 2 files no flags in the
+ * header.
+ */
+namespace WorkloadFormat {
+
+  constexpr char MAGIC[4] = {'C', 'P', 'W', 'L'};
+  constexpr uint32_t VERSION = 3;
+  constexpr size_t V1_HEADER_SIZE = sizeof(MAGIC) + sizeof(uint32_t) + sizeof(uint64_t);
+  constexpr size_t V2_HEADER_SIZE = V1_HEADER_SIZE + sizeof(uint32_t);
+  constexpr size_t HEADER_SIZE = V2_HEADER_SIZE + sizeof(uint32_t);
+
+  /** Every op is preceded by its timestamp */
+  constexpr uint32_t FLAG_TIMESTAMPS = 1;
+
+  /** Set in the op byte of an R whose end key is exclusive, i.e. not deleted */
+  constexpr unsigned char OP_EXCLUSIVE_END = 0x80;
+
+  inline bool IsKnownInstruction(const char instruction) {
+    switch (instruction) {
+      case 'I':
+      case 'U':
+      case 'D':
+      case 'Q':
+      case 'S':
+      case 'R':
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  inline void EncodeFixed32(char *buf, const uint32_t value) {
+    for (int i = 0; i < 4; i++)
+      buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+
+  inline void EncodeFixed64(char *buf, const uint64_t value) {
+    for (int i = 0; i < 8; i++)
+      buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+
+  inline uint32_t DecodeFixed32(const char *buf) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+      value |= static_cast<uint32_t>(static_cast<unsigned char>(buf[i])) << (8 * i);
+    return value;
+  }
+
+  inline uint64_t DecodeFixed64(const char *buf) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+      value |= static_cast<uint64_t>(static_cast<unsigned char>(buf[i])) << (8 * i);
+    return value;
+  }
+}  // namespace WorkloadFormat
+
+/**
+ * A single workload instruction.
+ * The slices point into memory owned by the reader and stay valid until the next call to Next.
+ */
+struct WorkloadOp {
+  char instruction = 0;
+  /** The position of the instruction in the workload, starting at 1 */
+  uint64_t line_num = 0;
+  /** The key for I/U/D/Q, or the start key for S/R */
+  rocksdb::Slice key;
+  /** The value for I/U */
+  rocksdb::Slice value;
+  /** The end key for S (exclusive) and R (inclusive, load_gen deletes the end key too, unless exclusive_end) */
+  rocksdb::Slice end_key;
+  /** For R, whether the end key is exclusive, as in DB::DeleteRange */
+  bool exclusive_end = false;
+  /** Microseconds since the start of the workload, for workloads with timestamps */
+  uint64_t timestamp = 0;
+  /**
+   * Under key hash partitioning, a scan or range delete covers keys of every client, so it reaches all clients,
+   * which wait for each other around it. Only the client its start key hashes to owns it and replays it.
+   */
+  bool barrier = false;
+  bool owned = true;
+};
+
+/** Sequential reader over the instructions of a workload file. */
+class WorkloadReader {
+public:
+  virtual ~WorkloadReader() = default;
+
+  /** Reads the next instruction into op, returning false at the end of the workload. */
+  virtual bool Next(WorkloadOp& op) = 0;
+
+  /** Whether the slices of an op stay valid for the lifetime of the reader, rather than until the next call to Next */
+  [[nodiscard]] virtual bool HasStableSlices() const { return false; }
+
+  /** Whether the ops carry the time they were issued at, see WorkloadOp::timestamp */
+  [[nodiscard]] virtual bool HasTimestamps() const { return false; }
+};
+
+/**
+ * Reads the text format token by token.
+ * The key/value buffers are reused between calls, so steady-state parsing does not allocate.
+ */
+class TextWorkloadReader final : public WorkloadReader {
+public:
+  explicit TextWorkloadReader(const std::string& path) : file_(path) {
+    ASSERT(file_.is_open(), "Failed to open workload file " + path);
+  }
+
+  bool Next(WorkloadOp& op) override {
+    if (!(file_ >> op.instruction))
+      return false;
+
+    op.line_num = ++line_num_;
+    op.key = op.value = op.end_key = rocksdb::Slice();
+    op.exclusive_end = false;
+    switch (op.instruction) {
+      case 'I':
+      case 'U':
+        file_ >> key_ >> arg_;
+        op.key = key_;
+        op.value = arg_;
+        break;
+
+      case 'D':
+      case 'Q':
+        file_ >> key_;
+        op.key = key_;
+        break;
+
+      case 'S':
+      case 'R':
+        file_ >> key_ >> arg_;
+        op.key = key_;
+        op.end_key = arg_;
+        break;
+
+      default:
+        break;
+    }
+
+    return true;
+  }
+
+private:
+  std::ifstream file_;
+  std::string key_;
+  std::string arg_;
+  uint64_t line_num_ = 0;
+};
+
+/**
+ * The contents of a whole file, through a read-only memory mapping (mmap, or MapViewOfFile on Windows).
+ * Where the file cannot be mapped, e.g. when it is empty, it is read into a buffer owned by the view instead.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+      nullptr);
+    LARGE_INTEGER size;
+    if (file_ != INVALID_HANDLE_VALUE && GetFileSizeEx(file_, &size) && size.QuadPart > 0) {
+      mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      const void *view = mapping_ != nullptr ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+      if (view != nullptr) {
+        data_ = rocksdb::Slice(static_cast<const char *>(view), static_cast<size_t>(size.QuadPart));
+        mapped_ = true;
+        return;
+      }
+    }
+#else
+    fd_ = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd_ >= 0 && fstat(fd_, &st) == 0 && st.st_size > 0) {
+      void *view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (view != MAP_FAILED) {
+        data_ = rocksdb::Slice(static_cast<const char *>(view), static_cast<size_t>(st.st_size));
+        mapped_ = true;
+        return;
+      }
+    }
+#endif
+
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    ASSERT(file.is_open(), "Failed to open workload file " + path);
+    buffer_.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    ASSERT(file.good() || buffer_.empty(), "Failed to read workload file " + path);
+    data_ = rocksdb::Slice(buffer_.data(), buffer_.size());
+  }
+
+  ~MappedFile() {
+#if defined(_WIN32)
+    if (mapped_)
+      UnmapViewOfFile(data_.data());
+    if (mapping_ != nullptr)
+      CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE)
+      CloseHandle(file_);
+#else
+    if (mapped_)
+      munmap(const_cast<char *>(data_.data()), data_.size());
+    if (fd_ >= 0)
+      close(fd_);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] const rocksdb::Slice& Data() const { return data_; }
+
+private:
+  rocksdb::Slice data_;
+  std::vector<char> buffer_;
+  bool mapped_ = false;
+#if defined(_WIN32)
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+/**
+ * Reads the binary format through a MappedFile of the whole file.
+ * The slices handed out point straight into the mapping, so replaying an op involves no copies or allocations.
+ */
+class BinaryWorkloadReader final : public WorkloadReader {
+public:
+  explicit BinaryWorkloadReader(const std::string& path) : file_(path), data_(file_.Data()) {
+    const size_t file_size = data_.size();
+    ASSERT(file_size >= WorkloadFormat::V1_HEADER_SIZE, "Truncated workload file " + path);
+
+    ASSERT(std::memcmp(data_.data(), WorkloadFormat::MAGIC, sizeof(WorkloadFormat::MAGIC)) == 0,
+      "Not a binary workload file " + path);
+    const uint32_t version = WorkloadFormat::DecodeFixed32(data_.data() + sizeof(WorkloadFormat::MAGIC));
+    ASSERT(version >= 1 && version <= WorkloadFormat::VERSION,
+      "Unsupported binary workload version " + std::to_string(version));
+    num_ops_ = WorkloadFormat::DecodeFixed64(data_.data() + sizeof(WorkloadFormat::MAGIC) + sizeof(uint32_t));
+    pos_ = WorkloadFormat::V1_HEADER_SIZE;
+    if (version >= 2) {
+      ASSERT(file_size >= WorkloadFormat::V2_HEADER_SIZE, "Truncated workload file " + path);
+      key_width_ = WorkloadFormat::DecodeFixed32(data_.data() + WorkloadFormat::V1_HEADER_SIZE);
+      pos_ = WorkloadFormat::V2_HEADER_SIZE;
+    }
+    if (version >= 3) {
+      ASSERT(file_size >= WorkloadFormat::HEADER_SIZE, "Truncated workload file " + path);
+      const uint32_t flags = WorkloadFormat::DecodeFixed32(data_.data() + WorkloadFormat::V2_HEADER_SIZE);
+      timestamps_ = (flags & WorkloadFormat::FLAG_TIMESTAMPS) != 0;
+      pos_ = WorkloadFormat::HEADER_SIZE;
+    }
+  }
+
+  bool Next(WorkloadOp& op) override {
+    if (pos_ >= data_.size())
+      return false;
+
+    const auto op_byte = static_cast<unsigned char>(data_[pos_++]);
+    op.instruction = static_cast<char>(op_byte & ~WorkloadFormat::OP_EXCLUSIVE_END);
+    op.exclusive_end = (op_byte & WorkloadFormat::OP_EXCLUSIVE_END) != 0;
+    op.line_num = ++line_num_;
+    if (timestamps_) {
+      ASSERT(pos_ + sizeof(uint64_t) <= data_.size(), "Truncated binary workload at offset " + std::to_string(pos_));
+      op.timestamp = WorkloadFormat::DecodeFixed64(data_.data() + pos_);
+      pos_ += sizeof(uint64_t);
+    }
+    op.key = ReadKey();
+    op.value = op.end_key = rocksdb::Slice();
+    if (op.instruction == 'I' || op.instruction == 'U') {
+      op.value = ReadLengthPrefixed();
+    } else if (op.instruction == 'S' || op.instruction == 'R') {
+      op.end_key = ReadKey();
+    }
+
+    return true;
+  }
+
+  [[nodiscard]] bool HasStableSlices() const override { return true; }
+
+  [[nodiscard]] bool HasTimestamps() const override { return timestamps_; }
+
+  /** The number of ops recorded in the header */
+  [[nodiscard]] uint64_t NumOps() const { return num_ops_; }
+
+  /** The width of every key, or 0 if keys are length-prefixed */
+  [[nodiscard]] uint32_t KeyWidth() const { return key_width_; }
+
+private:
+  rocksdb::Slice ReadKey() {
+    if (key_width_ == 0)
+      return ReadLengthPrefixed();
+    ASSERT(pos_ + key_width_ <= data_.size(), "Truncated binary workload at offset " + std::to_string(pos_));
+    const rocksdb::Slice result(data_.data() + pos_, key_width_);
+    pos_ += key_width_;
+    return result;
+  }
+
+  rocksdb::Slice ReadLengthPrefixed() {
+    ASSERT(pos_ + sizeof(uint32_t) <= data_.size(), "Truncated binary workload at offset " + std::to_string(pos_));
+    const uint32_t length = WorkloadFormat::DecodeFixed32(data_.data() + pos_);
+    pos_ += sizeof(uint32_t);
+    ASSERT(pos_ + length <= data_.size(), "Truncated binary workload at offset " + std::to_string(pos_));
+    const rocksdb::Slice result(data_.data() + pos_, length);
+    pos_ += length;
+    return result;
+  }
+
+  MappedFile file_;
+  rocksdb::Slice data_;
+  size_t pos_ = 0;
+  uint64_t line_num_ = 0;
+  uint64_t num_ops_ = 0;
+  uint32_t key_width_ = 0;
+  bool timestamps_ = false;
+};
+
+/**
+ * Writes the binary format. The op count in the header is patched in by Finish,
+ * so the output must be a seekable file. With a key width, every key must have exactly that size, and with
+ * timestamps, the timestamp of every op is written too.
+ */
+class BinaryWorkloadWriter {
+public:
+  explicit BinaryWorkloadWriter(const std::string& path, const uint32_t key_width = 0, const bool timestamps = false) :
+    buffer_(1 << 20), key_width_(key_width), timestamps_(timestamps) {
+    file_.rdbuf()->pubsetbuf(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    ASSERT(file_.is_open(), "Failed to open output file " + path);
+
+    char header[WorkloadFormat::HEADER_SIZE];
+    std::memcpy(header, WorkloadFormat::MAGIC, sizeof(WorkloadFormat::MAGIC));
+    WorkloadFormat::EncodeFixed32(header + sizeof(WorkloadFormat::MAGIC), WorkloadFormat::VERSION);
+    WorkloadFormat::EncodeFixed64(header + sizeof(WorkloadFormat::MAGIC) + sizeof(uint32_t), 0);
+    WorkloadFormat::EncodeFixed32(header + WorkloadFormat::V1_HEADER_SIZE, key_width_);
+    WorkloadFormat::EncodeFixed32(header + WorkloadFormat::V2_HEADER_SIZE,
+      timestamps_ ? WorkloadFormat::FLAG_TIMESTAMPS : 0);
+    file_.write(header, sizeof(header));
+  }
+
+  void Add(const WorkloadOp& op) {
+    const bool exclusive_end = op.instruction == 'R' && op.exclusive_end;
+    file_.put(static_cast<char>(exclusive_end ? op.instruction | WorkloadFormat::OP_EXCLUSIVE_END : op.instruction));
+    if (timestamps_) {
+      char timestamp[sizeof(uint64_t)];
+      WorkloadFormat::EncodeFixed64(timestamp, op.timestamp);
+      file_.write(timestamp, sizeof(timestamp));
+    }
+    WriteKey(op.key);
+    if (op.instruction == 'I' || op.instruction == 'U') {
+      WriteLengthPrefixed(op.value);
+    } else if (op.instruction == 'S' || op.instruction == 'R') {
+      WriteKey(op.end_key);
+    }
+    num_ops_++;
+  }
+
+  /** Writes the final op count into the header and closes the file. */
+  void Finish() {
+    char count[sizeof(uint64_t)];
+    WorkloadFormat::EncodeFixed64(count, num_ops_);
+    file_.seekp(sizeof(WorkloadFormat::MAGIC) + sizeof(uint32_t));
+    file_.write(count, sizeof(count));
+    file_.close();
+  }
+
+  [[nodiscard]] uint64_t NumOps() const { return num_ops_; }
+
+private:
+  void WriteKey(const rocksdb::Slice& key) {
+    if (key_width_ == 0)
+      return WriteLengthPrefixed(key);
+    ASSERT(key.size() == key_width_, "Key of " + std::to_string(key.size()) + " bytes in a workload of "
+      + std::to_string(key_width_) + "-byte keys");
+    file_.write(key.data(), static_cast<std::streamsize>(key.size()));
+  }
+
+  void WriteLengthPrefixed(const rocksdb::Slice& slice) {
+    char length[sizeof(uint32_t)];
+    WorkloadFormat::EncodeFixed32(length, static_cast<uint32_t>(slice.size()));
+    file_.write(length, sizeof(length));
+    file_.write(slice.data(), static_cast<std::streamsize>(slice.size()));
+  }
+
+  std::vector<char> buffer_;
+  std::ofstream file_;
+  uint32_t key_width_;
+  bool timestamps_;
+  uint64_t num_ops_ = 0;
+};
+
+/** How the workload is split between client threads */
+enum class WorkloadPartitioning {
+  /** Op i goes to thread i % N */
+  kRoundRobin,
+  /**
+   * Point ops go to the thread chosen by hashing their key, which keeps the order of ops on any one key. Range ops
+   * are barriers between all threads, so they are also ordered with the writes to every key in their range.
+   */
+  kKeyHash,
+};
+
+/**
+ * Passes through only the ops of the underlying workload that belong to one partition, plus the range ops of every
+ * partition under key hash partitioning, marked as barriers. Every partition scans the full workload, which is cheap
+ * for the mmapped binary format.
+ */
+class PartitionedWorkloadReader final : public WorkloadReader {
+public:
+  PartitionedWorkloadReader(std::unique_ptr<WorkloadReader> reader, const WorkloadPartitioning partitioning,
+    const int partition, const int num_partitions) :
+    reader_(std::move(reader)), partitioning_(partitioning), partition_(partition), num_partitions_(num_partitions) {}
+
+  bool Next(WorkloadOp& op) override {
+    while (reader_->Next(op)) {
+      op.owned = PartitionOf(op) == partition_;
+      op.barrier = partitioning_ == WorkloadPartitioning::kKeyHash && (op.instruction == 'S' || op.instruction == 'R');
+      if (op.owned || op.barrier)
+        return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] bool HasStableSlices() const override { return reader_->HasStableSlices(); }
+
+  [[nodiscard]] bool HasTimestamps() const override { return reader_->HasTimestamps(); }
+
+private:
+  [[nodiscard]] int PartitionOf(const WorkloadOp& op) const {
+    if (partitioning_ == WorkloadPartitioning::kRoundRobin)
+      return static_cast<int>((op.line_num - 1) % num_partitions_);
+    return static_cast<int>(std::hash<std::string_view>{}(std::string_view(op.key.data(), op.key.size())) % num_partitions_);
+  }
+
+  std::unique_ptr<WorkloadReader> reader_;
+  WorkloadPartitioning partitioning_;
+  int partition_;
+  int num_partitions_;
+};
+
+/** Checks the magic at the start of the file to tell the binary format apart from the text one. */
+inline bool IsBinaryWorkload(const std::string& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  char magic[sizeof(WorkloadFormat::MAGIC)];
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, WorkloadFormat::MAGIC, sizeof(magic)) == 0;
+}
+
+/** Opens a workload file in whichever format it is written in. */
+inline std::unique_ptr<WorkloadReader> OpenWorkload(const std::string& path) {
+  if (IsBinaryWorkload(path))
+    return std::make_unique<BinaryWorkloadReader>(path);
+  return std::make_unique<TextWorkloadReader>(path);
+}
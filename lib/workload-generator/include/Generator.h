@@ -1,10 +1,9 @@
 #ifndef GENERATOR_H
 #define GENERATOR_H
 
-#include <random>
 #include <iostream>
-#include <chrono>
 #include <vector>
+#include "Random.h"
 
 class Generator
 {
@@ -17,24 +16,49 @@ class Generator
 	double beta_beta_;
 	double zipf_alpha_;
 	int zipf_size_;
-	double zipf_searching_threshold_;
-	double zipf_normalize_constant;
-	std::default_random_engine gen;
-	std::uniform_int_distribution<int> distribution0;
-	std::normal_distribution<double> distribution1;
-	std::gamma_distribution<double> distribution2_x;
-	std::gamma_distribution<double> distribution2_y;
-	std::uniform_int_distribution<int> distribution3;
+	CounterRandom random_;
 
-	// for zipf distribution
-	std::uniform_real_distribution<double> uniform_standard_distribution;
-	std::vector<double> cumulative_probabilities;
-	std::vector<uint32_t> zipf_generator_small_area;
+	// for zipf distribution, sampled by rejection-inversion (Hormann and Derflinger, 1996) in constant time and space
+	struct ZipfConstants
+	{
+		double alpha;
+		double h_integral_x1;
+		double h_integral_size;
+		double s;
+	};
+	ZipfConstants zipf_;
+	ZipfConstants zipf_constants(double alpha) const;
+	static double zipf_h(double x, double alpha);
+	static double zipf_h_integral(double x, double alpha);
+	static double zipf_h_integral_inverse(double x, double alpha);
+	uint32_t zipf_next_rank(CounterRandom &random, const ZipfConstants &zipf) const;
+
+	// for a hot set that moves over time, see setPhases
+	uint64_t shift_period_ = 0;
+	double shift_step_ = 0;
+	double zipf_alpha_end_ = 0;
+	uint64_t alpha_period_ = 0;
+	uint64_t horizon_ = 0;
+	uint64_t shift_offset(uint64_t time, uint64_t size) const;
+	double zipf_alpha_at(uint64_t time) const;
+	uint32_t draw(CounterRandom &random, uint64_t time) const;
 
 public:
+	// every generator draws from its own stream of this seed, numbered in the order the generators are created
+	static uint64_t seed;
+	static uint64_t instances;
 	std::vector<int> index_mapping;
 	Generator();
 	Generator(int dist, uint32_t lb, uint32_t ub, double norm_mean, double norm_stddev, double beta_alpha, double beta_beta, double zipf_alpha, int zipf_size, std::vector<int> _index_mapping = {});
 	uint32_t getNext();
+	// draws from the given random numbers instead of the generator's own, so that threads can share a generator
+	uint32_t getNext(CounterRandom &random) const;
+	// draws as of the given time, e.g. the op number, for generators with phases
+	uint32_t getNextAt(uint64_t time);
+	uint32_t getNext(CounterRandom &random, uint64_t time) const;
+	// Makes the draws change over time. Every shift_period, the ranks rotate over the keys by shift_step of them, or to
+	// a random place if shift_step is 0. The zipf alpha moves to alpha_end and back in a cosine wave of period
+	// alpha_period, or linearly over the horizon if alpha_period is 0.
+	void setPhases(uint64_t shift_period, double shift_step, double alpha_end, uint64_t alpha_period, uint64_t horizon);
 };
 #endif
@@ -1,28 +1,31 @@
 #ifndef KEY_H
 #define KEY_H
 
-#include <random>
 #include <iostream>
-#include <cstring>
+#include <string>
+#include "KeyCodec.h"
+#include "Random.h"
 
 #define INTEGER_KEY_DOMAIN 1073741824 // 2^30
 #define STRING_PREFIX_DIGITS 2
 using namespace std;
 
+// A key of the workload, held as its integer value: 8 bytes, compared without branching, and written as a text key of
+// Key::width characters whose order is the order of the integers (see KeyCodec.h)
 class Key
 {
-	bool string_enabled_;
-
 public:
-	string key_str_;
-	uint32_t key_int32_;
+	uint64_t value_;
+	static int width;
 	static const char key_alphanum[];
 	Key();
-	Key(string key);
-	Key(uint32_t key);
+	Key(uint64_t value);
+	// reads a text key of the key width, false if it is not one
+	static bool parse(const string &text, Key *key);
 	bool operator<(const Key &t) const;
-	Key operator+(const Key &t);
+	bool operator==(const Key &t) const;
 	friend ostream &operator<<(ostream &os, const Key &t);
-	static Key get_key(int key_size, bool string_enabled = true);
+	// a random key whose leading prefix_digits digits are those of prefix
+	static Key get_key(CounterRandom &random, uint64_t prefix = 0, int prefix_digits = 0);
 };
 #endif
@@ -0,0 +1,120 @@
+#ifndef KEY_CODEC_H
+#define KEY_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Keys are integers written at a fixed width, either as text or as binary. Both encodings keep the order of the
+// integers under a bytewise comparison, so the generator can sort keys as integers and the DB sees the same order.
+namespace KeyCodec
+{
+	// the alphanumerics in ASCII order, the digits of text keys
+	constexpr char ALPHABET[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	constexpr uint64_t BASE = 62;
+	constexpr int MAX_TEXT_DIGITS = 10; // 62^10 < 2^64, wider text keys are padded with digits hashed from the value
+	constexpr int MAX_BINARY_BYTES = 8; // wider binary keys are padded with bytes hashed from the value
+
+	// the digits of a text key of the given width that carry its value
+	inline int TextDigits(int width)
+	{
+		return width < MAX_TEXT_DIGITS ? width : MAX_TEXT_DIGITS;
+	}
+
+	// the number of text keys of the given width
+	inline uint64_t TextDomain(int width)
+	{
+		uint64_t domain = 1;
+		for (int i = 0; i < TextDigits(width); i++)
+			domain *= BASE;
+		return domain;
+	}
+
+	// the number of binary keys of the given width, 0 standing for 2^64
+	inline uint64_t BinaryDomain(int width)
+	{
+		return width < MAX_BINARY_BYTES ? 1ULL << (8 * width) : 0;
+	}
+
+	// a hash of a key's value and a position in the key (SplitMix64's finalizer), for the padding of wide keys, so they
+	// do not end in a constant run that compresses and prefix-encodes better than real keys of that width
+	inline uint64_t PaddingHash(uint64_t value, int i)
+	{
+		uint64_t x = value + (uint64_t)(i + 1) * 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	// the padding digit at position i of a text key
+	inline char TextPadding(uint64_t value, int i)
+	{
+		return ALPHABET[PaddingHash(value, i) % BASE];
+	}
+
+	// the padding byte at position i of a binary key
+	inline char BinaryPadding(uint64_t value, int i)
+	{
+		return (char)(PaddingHash(value, i) & 0xff);
+	}
+
+	// writes width characters: the value in base 62, most significant digit first, then the padding digits. Distinct
+	// values differ within their first digits, so the padding does not change the order.
+	inline void EncodeText(uint64_t value, int width, char *out)
+	{
+		int digits = TextDigits(width);
+		for (int i = digits; i < width; i++)
+			out[i] = TextPadding(value, i);
+		for (int i = digits - 1; i >= 0; i--)
+		{
+			out[i] = ALPHABET[value % BASE];
+			value /= BASE;
+		}
+	}
+
+	// reads a key written by EncodeText, false if it is not one
+	inline bool DecodeText(const char *data, size_t width, uint64_t *value)
+	{
+		*value = 0;
+		for (size_t i = 0; i < width; i++)
+		{
+			char c = data[i];
+			uint64_t digit;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (c >= 'A' && c <= 'Z')
+				digit = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'z')
+				digit = c - 'a' + 36;
+			else
+				return false;
+			if (i < (size_t)MAX_TEXT_DIGITS)
+				*value = *value * BASE + digit;
+			else if (c != TextPadding(*value, (int)i))
+				return false;
+		}
+		return true;
+	}
+
+	// writes width bytes: the value big-endian, then the padding bytes, which do not change the order either
+	inline void EncodeBinary(uint64_t value, int width, char *out)
+	{
+		int bytes = width < MAX_BINARY_BYTES ? width : MAX_BINARY_BYTES;
+		for (int i = bytes; i < width; i++)
+			out[i] = BinaryPadding(value, i);
+		for (int i = bytes - 1; i >= 0; i--)
+		{
+			out[i] = (char)(value & 0xff);
+			value >>= 8;
+		}
+	}
+
+	inline uint64_t DecodeBinary(const char *data, int width)
+	{
+		int bytes = width < MAX_BINARY_BYTES ? width : MAX_BINARY_BYTES;
+		uint64_t value = 0;
+		for (int i = 0; i < bytes; i++)
+			value = (value << 8) | (unsigned char)data[i];
+		return value;
+	}
+}
+#endif
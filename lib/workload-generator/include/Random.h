@@ -0,0 +1,106 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cmath>
+#include <cstdint>
+
+// pi, since M_PI is not standard and MSVC leaves it out of <cmath>
+constexpr double RANDOM_PI = 3.14159265358979323846;
+
+// A counter-based random number generator: the n-th number of a stream is a hash of the stream's key and n (SplitMix64),
+// so a stream splits into independent streams by key, and any position of a stream can be reached without generating
+// the numbers before it. The integers are pure integer arithmetic, so a seed gives the same integers on every machine.
+// The continuous distributions go through log, pow, exp and cos of the platform's math library, which are not
+// correctly rounded and may differ in the last bit between libraries, so a workload is only guaranteed identical
+// for the same build (for any number of threads).
+class CounterRandom
+{
+	uint64_t key_;
+	uint64_t counter_;
+
+	static uint64_t mix(uint64_t x)
+	{
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+public:
+	typedef uint64_t result_type;
+
+	CounterRandom(uint64_t seed = 0, uint64_t stream = 0) : key_(mix(mix(seed) + stream * 0x9e3779b97f4a7c15ULL)), counter_(0) {}
+
+	// an independent stream, the same for the same stream number
+	CounterRandom split(uint64_t stream) const
+	{
+		return CounterRandom(key_, stream);
+	}
+
+	uint64_t position() const
+	{
+		return counter_;
+	}
+
+	void seek(uint64_t position)
+	{
+		counter_ = position;
+	}
+
+	uint64_t next()
+	{
+		return mix(key_ + ++counter_ * 0x9e3779b97f4a7c15ULL);
+	}
+
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return ~0ULL; }
+	uint64_t operator()() { return next(); }
+
+	// uniform in [0, n)
+	uint64_t next_below(uint64_t n)
+	{
+		return next() % n;
+	}
+
+	// uniform in [0, 1)
+	double next_double()
+	{
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// standard normal, by the Box-Muller transform
+	double next_normal()
+	{
+		double u1 = 1.0 - next_double();
+		double u2 = next_double();
+		return sqrt(-2.0 * log(u1)) * cos(2.0 * RANDOM_PI * u2);
+	}
+
+	// gamma with the given shape and scale 1, by Marsaglia and Tsang's method
+	double next_gamma(double shape)
+	{
+		if (shape < 1)
+		{
+			double u = 1.0 - next_double();
+			return next_gamma(shape + 1) * pow(u, 1.0 / shape);
+		}
+		double d = shape - 1.0 / 3.0;
+		double c = 1.0 / sqrt(9.0 * d);
+		while (true)
+		{
+			double x;
+			double v;
+			do
+			{
+				x = next_normal();
+				v = 1.0 + c * x;
+			} while (v <= 0);
+			v = v * v * v;
+			double u = next_double();
+			if (u < 1.0 - 0.0331 * x * x * x * x || log(u) < 0.5 * x * x + d * (1.0 - v + log(v)))
+			{
+				return d * v;
+			}
+		}
+	}
+};
+#endif
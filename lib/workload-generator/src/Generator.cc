@@ -1,63 +1,38 @@
 #include "Generator.h"
 #include "math.h"
 #include <algorithm>
-#include "time.h"
 
-#define ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS 1000
-#define ZIPFIAN_GENERATOR_SMALL_AREA_SIZE 50000
+uint64_t Generator::seed = 0;
+uint64_t Generator::instances = 0;
 
-std::random_device rd;
-std::mt19937 g(rd());
+// log1p(x) / x, accurate around 0
+inline double helper1(double x)
+{
+	if (fabs(x) > 1e-8)
+	{
+		return log1p(x) / x;
+	}
+	return 1 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
 
-inline int binary_search(double p, int low, int high, std::vector<double> &cdf)
+// expm1(x) / x, accurate around 0
+inline double helper2(double x)
 {
-	// std::cout << "p : " << p << "\tlow : " << low << "\t high : " << high << std::endl;
-	int mid = (low + high) / 2;
-	while (high - low > 1)
+	if (fabs(x) > 1e-8)
 	{
-		// std::cout << "p: " << p << "\tmid: " << cumulative_probabilities[mid] << "\tmid+1: " << cumulative_probabilities[mid+1] << std::endl;
-		if (p < cdf[mid])
-		{
-			high = mid;
-		}
-		else if (p >= cdf[mid + 1])
-		{
-			low = mid;
-		}
-		else
-		{
-			break;
-		}
-		mid = (low + high) / 2;
+		return expm1(x) / x;
 	}
-	return mid;
+	return 1 + x * 0.5 * (1 + x / 3.0 * (1 + 0.25 * x));
 }
 
 Generator::Generator() {}
 Generator::Generator(int dist, uint32_t lb, uint32_t ub, double norm_mean, double norm_stddev, double beta_alpha, double beta_beta, double zipf_alpha, int zipf_size, std::vector<int> _index_mapping) : dist_(dist), lb_(lb), ub_(ub), norm_mean_(norm_mean), norm_stddev_(norm_stddev), beta_alpha_(beta_alpha), beta_beta_(beta_beta), zipf_alpha_(zipf_alpha), zipf_size_(zipf_size)
 {
-	gen.seed(std::chrono::system_clock::now().time_since_epoch().count());
-	distribution0 = std::uniform_int_distribution<int>(lb_, ub_);
-	distribution1 = std::normal_distribution<double>(norm_mean_, norm_stddev_);
-	distribution2_x = std::gamma_distribution<double>(beta_alpha_, 1.0);
-	distribution2_y = std::gamma_distribution<double>(beta_beta_, 1.0);
-	distribution3 = std::uniform_int_distribution<int>(0, ZIPFIAN_GENERATOR_SMALL_AREA_SIZE - 1);
+	random_ = CounterRandom(seed, instances++);
 
 	// for zipfian distribution
 	if (dist == 3)
 	{
-		double zipf_small_normalize_constant = 0;
-		zipf_generator_small_area = std::vector<uint32_t>(ZIPFIAN_GENERATOR_SMALL_AREA_SIZE, 0);
-		std::vector<double> *small_cumulative_probabilities = new std::vector<double>(ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS + 1, 0);
-		zipf_normalize_constant = 0;
-		for (int i = 1; i < zipf_size_; i++)
-		{
-			zipf_normalize_constant += 1 / (pow((double)i, zipf_alpha_));
-			if (i == ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS)
-			{
-				zipf_small_normalize_constant = zipf_normalize_constant;
-			}
-		}
 		if (_index_mapping.size() == 0)
 		{
 			index_mapping = std::vector<int>(zipf_size_, 0);
@@ -73,126 +48,182 @@ Generator::Generator(int dist, uint32_t lb, uint32_t ub, double norm_mean, doubl
 			int size = _index_mapping.size();
 			while (size < zipf_size_)
 			{
-				int pos = rand() % size;
+				int pos = random_.next_below(size);
 				index_mapping.insert(index_mapping.begin() + pos, size);
 				size++;
 			}
 		}
-		cumulative_probabilities = std::vector<double>(zipf_size + 1, 0.0);
-		cumulative_probabilities[0] = 0.0;
-		small_cumulative_probabilities->at(0) = 0.0;
-		for (int i = 1; i < zipf_size_; i++)
+		// Fisher-Yates, rather than std::shuffle whose algorithm differs between standard libraries
+		for (int i = zipf_size_ - 1; i > 0; i--)
 		{
-			cumulative_probabilities[i] = cumulative_probabilities[i - 1] + 1 / (pow((double)i, zipf_alpha_) * zipf_normalize_constant);
-			if (i <= ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS)
-			{
-				small_cumulative_probabilities->at(i) = small_cumulative_probabilities->at(i - 1) + 1.0 / (pow((double)i, zipf_alpha_) * zipf_small_normalize_constant);
-			}
+			std::swap(index_mapping[i], index_mapping[random_.next_below(i + 1)]);
 		}
-		zipf_searching_threshold_ = cumulative_probabilities[ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS];
-		cumulative_probabilities[zipf_size_] = 1.0;
-		small_cumulative_probabilities->at(ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS) = 1.0;
-		std::shuffle(index_mapping.begin(), index_mapping.end(), g);
 
-		double p;
-		for (uint32_t k = 0; k < ZIPFIAN_GENERATOR_SMALL_AREA_SIZE; k++)
-		{
-			p = uniform_standard_distribution(gen);
-			while (p == 0 || p == 1)
-				p = uniform_standard_distribution(gen);
-			zipf_generator_small_area[k] = binary_search(p, 0, ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS - 1, *small_cumulative_probabilities);
-		}
-		std::cout << std::endl;
-		small_cumulative_probabilities->clear();
-		delete small_cumulative_probabilities;
+		zipf_ = zipf_constants(zipf_alpha_);
 	}
-	else
+	zipf_alpha_end_ = zipf_alpha_;
+}
+
+void Generator::setPhases(uint64_t shift_period, double shift_step, double alpha_end, uint64_t alpha_period, uint64_t horizon)
+{
+	shift_period_ = shift_period;
+	shift_step_ = shift_step;
+	zipf_alpha_end_ = alpha_end;
+	alpha_period_ = alpha_period;
+	horizon_ = horizon;
+}
+
+uint32_t Generator::getNext()
+{
+	return getNext(random_);
+}
+
+uint32_t Generator::getNext(CounterRandom &random) const
+{
+	return getNext(random, 0);
+}
+
+uint32_t Generator::getNextAt(uint64_t time)
+{
+	return getNext(random_, time);
+}
+
+// how far the ranks have rotated over size keys at a time
+uint64_t Generator::shift_offset(uint64_t time, uint64_t size) const
+{
+	if (shift_period_ == 0 || size == 0)
 	{
-		/*
-		cumulative_probabilities = std::vector<double> ( zipf_size+1, 0.0);
-		index_mapping = std::vector<int> (zipf_size_, 0);
-		if(zipf_size_ == 0){
-			zipf_size_ = 1;
-		}
-		double unit = 1/zipf_size_;
-		for(int i = 0; i < zipf_size; i++){
-			cumulative_probabilities[i+1] = cumulative_probabilities[i] + unit;
-	index_mapping[i] = i;
-		}*/
-		cumulative_probabilities = std::vector<double>();
+		return 0;
+	}
+	uint64_t phase = time / shift_period_;
+	if (phase == 0)
+	{
+		return 0;
+	}
+	if (shift_step_ > 0)
+	{
+		return (uint64_t)(phase * shift_step_ * size) % size;
 	}
-	uniform_standard_distribution = std::uniform_real_distribution<double>(0.0, 1.0);
+	return random_.split(phase).next() % size;
 }
 
-uint32_t Generator::getNext()
+double Generator::zipf_alpha_at(uint64_t time) const
+{
+	double weight = 0;
+	if (alpha_period_ > 0)
+	{
+		weight = (1 - cos(2 * RANDOM_PI * (double)(time % alpha_period_) / alpha_period_)) / 2;
+	}
+	else if (horizon_ > 0)
+	{
+		weight = std::min(1.0, (double)time / horizon_);
+	}
+	return zipf_alpha_ + (zipf_alpha_end_ - zipf_alpha_) * weight;
+}
+
+uint32_t Generator::getNext(CounterRandom &random, uint64_t time) const
+{
+	uint32_t index = draw(random, time);
+	if (dist_ == 3 || shift_period_ == 0)
+	{
+		return index;
+	}
+	uint64_t size = (uint64_t)ub_ - lb_ + 1;
+	return lb_ + (uint32_t)((index - lb_ + shift_offset(time, size)) % size);
+}
+
+// the distributions are transforms of the uniform numbers written out here, rather than the std:: distributions whose
+// algorithms differ between standard libraries, so that a seed gives the same workload everywhere
+uint32_t Generator::draw(CounterRandom &random, uint64_t time) const
 {
 	switch (dist_)
 	{ // 0 -> uniform; 1 -> norm; 2 -> beta; 3-> Zipf
 	case 0:
 	{
-		uint32_t number = (uint32_t)distribution0(gen);
-		while (number < lb_ || number > ub_)
-		{
-			number = distribution0(gen);
-		}
-		return number;
+		return lb_ + (uint32_t)random.next_below((uint64_t)ub_ - lb_ + 1);
 	}
 	case 1:
 	{
-		uint32_t number = (uint32_t)round(distribution1(gen));
+		double number = round(norm_mean_ + norm_stddev_ * random.next_normal());
 		while (number < lb_ || number > ub_)
 		{
-			number = (uint32_t)round(distribution1(gen));
+			number = round(norm_mean_ + norm_stddev_ * random.next_normal());
 		}
-		return number;
+		return (uint32_t)number;
 	}
 	case 2:
 	{
-		double X = distribution2_x(gen);
-		double Y = distribution2_y(gen);
+		double X = random.next_gamma(beta_alpha_);
+		double Y = random.next_gamma(beta_beta_);
 		return lb_ + round((ub_ - lb_) * (X / (X + Y)));
 	}
 	case 3:
 	{
-		double p = uniform_standard_distribution(gen);
-		while (p == 0 || p == 1)
-			p = uniform_standard_distribution(gen);
+		uint32_t rank = zipf_alpha_end_ == zipf_alpha_ ? zipf_next_rank(random, zipf_) : zipf_next_rank(random, zipf_constants(zipf_alpha_at(time)));
+		return index_mapping[(rank - 1 + shift_offset(time, zipf_size_)) % zipf_size_];
+	}
+	default:
+	{
+		std::cout << "Unexpected case" << std::endl;
+		return 0;
+	}
+	}
+}
 
-		if (p < zipf_searching_threshold_)
-		{
-			return index_mapping[zipf_generator_small_area[distribution3(gen)]];
-		}
-		else if (p == zipf_searching_threshold_)
+// h(x) = 1/x^alpha, the unnormalized probability of rank x
+double Generator::zipf_h(double x, double alpha)
+{
+	return exp(-alpha * log(x));
+}
+
+// an antiderivative of h, also for alpha = 1
+double Generator::zipf_h_integral(double x, double alpha)
+{
+	double log_x = log(x);
+	return helper2((1 - alpha) * log_x) * log_x;
+}
+
+double Generator::zipf_h_integral_inverse(double x, double alpha)
+{
+	double t = x * (1 - alpha);
+	if (t < -1)
+	{
+		t = -1;
+	}
+	return exp(helper1(t) * x);
+}
+
+// rank k in [1, zipf_size] is drawn with probability proportional to 1/k^alpha
+Generator::ZipfConstants Generator::zipf_constants(double alpha) const
+{
+	ZipfConstants zipf;
+	zipf.alpha = alpha;
+	zipf.h_integral_x1 = zipf_h_integral(1.5, alpha) - 1;
+	zipf.h_integral_size = zipf_h_integral(zipf_size_ + 0.5, alpha);
+	zipf.s = 2 - zipf_h_integral_inverse(zipf_h_integral(2.5, alpha) - zipf_h(2, alpha), alpha);
+	return zipf;
+}
+
+// draws x from the continuous density h on [0.5, zipf_size + 0.5] by inversion, rounds it to the nearest rank and
+// accepts it if it falls under the histogram of the discrete distribution, which it does almost always
+uint32_t Generator::zipf_next_rank(CounterRandom &random, const ZipfConstants &zipf) const
+{
+	while (true)
+	{
+		double u = zipf.h_integral_size + random.next_double() * (zipf.h_integral_x1 - zipf.h_integral_size);
+		double x = zipf_h_integral_inverse(u, zipf.alpha);
+		double k = floor(x + 0.5);
+		if (k < 1)
 		{
-			return index_mapping[ZIPFIAN_THRESHOLD_UNIQ_ELEMENTS];
+			k = 1;
 		}
-		int step = 1;
-		int start = 0;
-		int low = 0;
-		int high = zipf_size_ - 1;
-		for (; start < zipf_size_; start += step)
+		else if (k > zipf_size_)
 		{
-			if (cumulative_probabilities[start] >= p)
-			{
-				low = start > step ? (start - step + 1) : 0;
-				high = start;
-				break;
-			}
-			step *= 2;
+			k = zipf_size_;
 		}
-
-		if (start > zipf_size_)
+		if (k - x <= zipf.s || u >= zipf_h_integral(k + 0.5, zipf.alpha) - zipf_h(k, zipf.alpha))
 		{
-			low = start - step;
-			high = zipf_size_ - 1;
+			return (uint32_t)k;
 		}
-
-		return index_mapping[binary_search(p, low, high, cumulative_probabilities)];
-	}
-	default:
-	{
-		std::cout << "Unexpected case" << std::endl;
-		return 0;
-	}
 	}
 }
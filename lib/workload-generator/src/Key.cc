@@ -1,77 +1,51 @@
 #include "Key.h"
 
-const char Key::key_alphanum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+int Key::width = 4;
+const char Key::key_alphanum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 Key::Key()
 {
-  string_enabled_ = true;
-  key_str_ = "";
+  value_ = 0;
 }
 
-Key::Key(string key)
+Key::Key(uint64_t value)
 {
-  key_str_ = key;
-  string_enabled_ = true;
+  value_ = value;
 }
 
-Key::Key(uint32_t key)
+bool Key::parse(const string &text, Key *key)
 {
-  key_int32_ = key;
-  string_enabled_ = false;
+  return (int)text.size() == width && KeyCodec::DecodeText(text.data(), text.size(), &key->value_);
 }
 
 bool Key::operator<(const Key &t) const
 {
-  if (string_enabled_)
-  {
-    return key_str_ < t.key_str_;
-  }
-  else
-  {
-    return key_int32_ < t.key_int32_;
-  }
+  return value_ < t.value_;
 }
 
-Key Key::operator+(const Key &t)
+bool Key::operator==(const Key &t) const
 {
-  if (string_enabled_)
-  {
-    return Key(this->key_str_ + t.key_str_);
-  }
-  else
-  {
-    return Key(this->key_int32_ + t.key_int32_);
-  }
+  return value_ == t.value_;
 }
 
-Key Key::get_key(int _key_size, bool string_enabled)
+Key Key::get_key(CounterRandom &random, uint64_t prefix, int prefix_digits)
 {
-  if (string_enabled)
-  {
-    char *s = new char[(int)_key_size];
-    for (int i = 0; i < _key_size; ++i)
-    {
-      s[i] = key_alphanum[rand() % (sizeof(key_alphanum) - 1)];
-    }
-    s[_key_size] = '\0';
-    return Key(string(s));
-  }
-  else
+  uint64_t suffix_domain = KeyCodec::TextDomain(width);
+  for (int i = 0; i < prefix_digits; i++)
   {
-    // here key_size means bits in fact
-    uint32_t domain_size = (uint32_t)(pow(2, _key_size) - 1);
-    return Key((uint32_t)(rand() * rand()) % domain_size);
+    suffix_domain /= KeyCodec::BASE;
   }
+  return Key(prefix * suffix_domain + random.next_below(suffix_domain));
 }
 
 ostream &operator<<(ostream &os, const Key &t)
 {
-  if (t.string_enabled_)
-  {
-    os << t.key_str_;
-  }
-  else
+  char buffer[256];
+  char *text = Key::width <= (int)sizeof(buffer) ? buffer : new char[Key::width];
+  KeyCodec::EncodeText(t.value_, Key::width, text);
+  os.write(text, Key::width);
+  if (text != buffer)
   {
-    os << t.key_int32_;
+    delete[] text;
   }
   return os;
 }
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <sstream>
 #include <set>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <random>
@@ -15,9 +16,11 @@
 #include <fstream>
 #include <cmath>
 #include <iomanip>
+#include <thread>
 #include "args.hxx"
 #include "Generator.h"
 #include "Key.h"
+#include "Random.h"
 
 #define U_THRESHOLD 0.1   // U_THRESHOLD*insert_count number of inserts must be made before Updates may take place (applicable when an empty database is being populated)
 #define PD_THRESHOLD 0.1  // PD_THRESHOLD*insert_count number of inserts must be made before Point Deletes may take place (applicable when an empty database is being populated)
@@ -25,6 +28,14 @@
 #define PQ_THRESHOLD 0.1  // PQ_THRESHOLD*insert_count number of inserts must be made before Point Queries may take place (applicable when an empty database is being populated)
 #define RQ_THRESHOLD 0.1  // RQ_THRESHOLD*insert_count number of inserts must be made before Range Queries may take place (applicable when an empty database is being populated)
 #define STRING_KEY_ENABLED true
+#define OUTPUT_BUFFER_SIZE (1 << 22) // 4 MB of workload lines are written at once
+#define STREAMING_SPARE_SLOTS 1024 // insert slots beyond the inserts, to replace the slots whose key was preloaded
+#define STREAMING_SEGMENT_SIZE 65536 // ops per segment, the unit of work of the threads generating a streaming workload
+// the streams of the seed
+#define RANDOM_STREAM_WORKLOAD 0 // the workload without streaming, and the key permutations with it
+#define RANDOM_STREAM_GENERATORS 1 // the seed of the index generators
+#define RANDOM_STREAM_CHOICES 2 // the op types of a streaming workload
+#define RANDOM_STREAM_OPS 3 // the keys and values of a streaming workload, split again by op number
 
 // using namespace std;
 
@@ -52,8 +63,13 @@ float lambda = -1; // lambda = key_size / (key_size + value_size) ; key_size = e
 bool load_from_existing_workload = false;
 std::string preload_filename = "";
 std::string out_filename = "";
+bool streaming = false;
+uint64_t seed = 0;
+int num_threads = 1;
+CounterRandom workload_random;
 
 const char value_alphanum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"; // "0123456789";
+uint64_t streaming_slot_stride = 1;
 
 std::vector<Key> insert_pool;
 std::set<Key> global_insert_pool_set;
@@ -91,13 +107,20 @@ float existing_point_lookup_norm_stddev = 0.1;
 float existing_point_lookup_beta_alpha = 1.0;
 float existing_point_lookup_beta_beta = 1.0;
 float existing_point_lookup_zipf_alpha = 1.0;
+long existing_point_lookup_shift_period = 0; // the hot set moves every this many ops, 0 keeps it in place
+float existing_point_lookup_shift_step = 0;  // the fraction of the keys it moves by, 0 to jump to a random place
+float existing_point_lookup_zipf_alpha_end = 1.0;
+long existing_point_lookup_zipf_alpha_period = 0; // 0 moves alpha to its end value linearly over the workload
 Generator *existingPointLookupIndexGenerator = nullptr;
 
 int parse_arguments2(int argc, char *argv[]);
-int get_choice(long, long, long, long, long, long, long, long, long, long, long, long, long);
+int get_choice(CounterRandom &, long, long, long, long, long, long, long, long, long, long, long, long, long);
 void generate_workload();
+void generate_workload_streaming();
+void set_existing_point_lookup_phases(Generator *generator, long total_operation_count);
 void print_workload_parameters(int _insert_count, int _update_count, int _point_delete_count, int _range_delete_count, int _effective_ingestion_count);
 std::string get_value(int _value_size);
+void fill_value(std::string &buffer, int _value_size, CounterRandom &random);
 inline void showProgress(const uint32_t &n, const uint32_t &count);
 
 /*
@@ -115,16 +138,21 @@ Key get_key(int _key_size){
     return s;
 }*/
 
-std::string get_value(int _value_size)
+// fills the buffer with a random value, reusing its allocation
+void fill_value(std::string &buffer, int _value_size, CounterRandom &random)
 {
-    // std::cout << key_size << std::endl;
-    char *s = new char[(int)_value_size];
+    buffer.resize(_value_size);
     for (int i = 0; i < _value_size; ++i)
     {
-        s[i] = value_alphanum[rand() % (sizeof(value_alphanum) - 1)];
+        buffer[i] = value_alphanum[random.next_below(sizeof(value_alphanum) - 1)];
     }
-    s[_value_size] = '\0';
-    return s;
+}
+
+std::string get_value(int _value_size)
+{
+    std::string value;
+    fill_value(value, _value_size, workload_random);
+    return value;
 }
 
 std::vector<std::string> StringSplit(const std::string &arg, char delim)
@@ -160,10 +188,11 @@ void generate_workload()
             while (getline(fin, line))
             {
                 splits = StringSplit(line, ' ');
-                Key key = splits[1];
-                if (!STRING_KEY_ENABLED)
+                Key key;
+                if (!Key::parse(splits[1], &key))
                 {
-                    key = atoi(splits[1].c_str());
+                    std::cout << "\033[1;31m ERROR:\033[0m preloaded key " << splits[1] << " is not a key of the key size written by this generator" << std::endl;
+                    exit(1);
                 }
                 if (tmp_insert_pool_set.find(key) == tmp_insert_pool_set.end())
                 {
@@ -182,7 +211,10 @@ void generate_workload()
         std::cout << "\033[1;31m ERROR:\033[0m insert_count < point_delete_count + range_delete_count * range_delete_selectivity * insert_count" << std::endl;
         exit(0);
     }
+    // lines are written into a large buffer instead of being flushed one by one
+    std::vector<char> out_buffer(OUTPUT_BUFFER_SIZE);
     std::ofstream fp;
+    fp.rdbuf()->pubsetbuf(out_buffer.data(), out_buffer.size());
     if (out_filename.compare("") == 0)
     {
 
@@ -210,6 +242,7 @@ void generate_workload()
     int choice_domain = 6;
     int flag = 0;
     std::tuple<long, long> _last_range_query = std::make_tuple(0, 0);
+    std::string value_buffer;
 
     uint32_t num_char = (std::string(Key::key_alphanum)).size();
     uint32_t num_preserved_bits = 10;
@@ -224,7 +257,6 @@ void generate_workload()
         uint32_t int32_preserved_insert_domain_size = pow(2, num_preserved_bits);
         insertIndexGenerator = new Generator(insert_dist, 0, int32_preserved_insert_domain_size - 1, insert_norm_mean_percentile * int32_preserved_insert_domain_size, insert_norm_stddev * int32_preserved_insert_domain_size, insert_beta_alpha, insert_beta_beta, insert_zipf_alpha, int32_preserved_insert_domain_size);
     }
-    char prefix[] = "00";
 
     std::cout << "Progress: ";
 
@@ -239,26 +271,12 @@ void generate_workload()
         aggregate_progress++;
 
         Key key;
-        Key key_suffix;
         // std::cout << key << std::endl;
         do
         {
-
+            // the generated index picks the leading digits of the key
             uint32_t index = insertIndexGenerator->getNext();
-            if (STRING_KEY_ENABLED)
-            {
-                key_suffix = Key::get_key(key_size - 2, STRING_KEY_ENABLED);
-                prefix[0] = Key::key_alphanum[(index / 62) % 62];
-                prefix[1] = Key::key_alphanum[index % 62];
-                key = Key(prefix);
-                key = key + key_suffix;
-            }
-            else
-            {
-                key_suffix = Key::get_key(32 - num_preserved_bits, STRING_KEY_ENABLED);
-                index <<= (32 - num_preserved_bits);
-                key = Key(key_suffix.key_int32_ | index);
-            }
+            key = Key::get_key(workload_random, index % (num_char * num_char), STRING_PREFIX_DIGITS);
         } while (tmp_insert_pool_set.find(key) != tmp_insert_pool_set.end());
         tmp_insert_pool_set.insert(key);
         global_insert_pool.push_back(key);
@@ -280,14 +298,14 @@ void generate_workload()
         //        do {
         //            uint32_t index = insertIndexGenerator->getNext();
         //            if (STRING_KEY_ENABLED) {
-        //                key_suffix = Key::get_key(key_size - 2, STRING_KEY_ENABLED);
+        //                key_suffix = Key::get_key(key_size - 2, workload_random, STRING_KEY_ENABLED);
         //                prefix[0] = Key::key_alphanum[(index/62)%62];
         //                prefix[1] = Key::key_alphanum[index%62];
         //                key = Key(prefix);
         //                key = key + key_suffix;
         //            }
         //            else {
-        //                key_suffix = Key::get_key(32 - num_preserved_bits, STRING_KEY_ENABLED);
+        //                key_suffix = Key::get_key(32 - num_preserved_bits, workload_random, STRING_KEY_ENABLED);
         //                index <<= (32 - num_preserved_bits);
         //                key = Key(key_suffix.key_int32_ | index);
         //            }
@@ -309,17 +327,10 @@ void generate_workload()
         }
         aggregate_progress++;
 
-        Key key;
-        if (STRING_KEY_ENABLED)
-            key = Key::get_key(key_size, STRING_KEY_ENABLED);
-        else
-            key = Key::get_key(32, STRING_KEY_ENABLED);
+        Key key = Key::get_key(workload_random);
         while (tmp_insert_pool_set.find(key) != tmp_insert_pool_set.end() || global_non_existing_key_set.find(key) != global_non_existing_key_set.end())
         {
-            if (STRING_KEY_ENABLED)
-                key = Key::get_key(key_size, STRING_KEY_ENABLED);
-            else
-                key = Key::get_key(32, STRING_KEY_ENABLED);
+            key = Key::get_key(workload_random);
         }
         global_non_existing_key_set.insert(key);
         global_non_existing_key_pool.push_back(key);
@@ -344,7 +355,7 @@ void generate_workload()
             std::cout << "#" << std::flush;
         }
 
-        int choice = get_choice(insert_pool.size(), insert_count, update_count, point_delete_count, range_delete_count, point_query_count, range_query_count, _insert_count, _update_count, _point_delete_count, _range_delete_count, _point_query_count, _range_query_count);
+        int choice = get_choice(workload_random, insert_pool.size(), insert_count, update_count, point_delete_count, range_delete_count, point_query_count, range_query_count, _insert_count, _update_count, _point_delete_count, _range_delete_count, _point_query_count, _range_query_count);
 
         if (choice == 0)
             continue;
@@ -352,14 +363,14 @@ void generate_workload()
         else if (choice == 1)
         { // INSERT
             long global_insert_pool_size = global_insert_pool.size();
-            long index = (long)(rand() % (global_insert_pool_size - _insert_count));
+            long index = (long)workload_random.next_below(global_insert_pool_size - _insert_count);
             Key key = global_insert_pool[index + _insert_count];
             // swap the key with the first element after inserted ones
             global_insert_pool[index + _insert_count] = global_insert_pool[_insert_count];
             global_insert_pool[_insert_count] = key;
             // std::cout << value << std::endl;
 
-            Key value = get_value(entry_size - key_size);
+            fill_value(value_buffer, entry_size - key_size, workload_random);
             if (sorted)
             {
                 std::vector<Key>::iterator it = std::upper_bound(insert_pool.begin(), insert_pool.end(), key);
@@ -371,7 +382,7 @@ void generate_workload()
             }
             global_insert_pool_set.insert(key);
             // std::cout << "I " << key << " " << value << std::endl;
-            fp << "I " << key << " " << value << std::endl;
+            fp << "I " << key << " " << value_buffer << '\n';
             _insert_count++;
             _effective_ingestion_count++;
             _total_operation_count++;
@@ -409,7 +420,7 @@ void generate_workload()
                 Key key = global_insert_pool[index];
                 global_insert_pool[index] = global_insert_pool[_insert_count];
                 global_insert_pool[_insert_count] = key;
-                Key value = get_value(entry_size - key_size);
+                fill_value(value_buffer, entry_size - key_size, workload_random);
                 if (sorted)
                 {
                     std::vector<Key>::iterator it = std::upper_bound(insert_pool.begin(), insert_pool.end(), key);
@@ -420,7 +431,7 @@ void generate_workload()
                     insert_pool.push_back(key);
                 }
                 global_insert_pool_set.insert(key);
-                fp << "I " << key << " " << value << std::endl;
+                fp << "I " << key << " " << value_buffer << '\n';
                 _insert_count++;
                 _effective_ingestion_count++;
             }
@@ -428,10 +439,9 @@ void generate_workload()
             {
                 Key key = insert_pool[index];
                 // std::cout << key << std::endl;
-                Key value = get_value(entry_size - key_size);
-                // std::cout << value << std::endl;
-                // std::cout << "U " << key << " " << value << std::endl;
-                fp << "U " << key << " " << value << std::endl;
+                fill_value(value_buffer, entry_size - key_size, workload_random);
+                // std::cout << "U " << key << " " << value_buffer << std::endl;
+                fp << "U " << key << " " << value_buffer << '\n';
                 _update_count++;
             }
 
@@ -450,7 +460,7 @@ void generate_workload()
             {
                 // std::cout << "_insert_count " << _insert_count << " ; _update_count " << _update_count << std::endl;
                 long insert_pool_size = insert_pool.size();
-                long index = (long)(rand() % insert_pool_size);
+                long index = (long)workload_random.next_below(insert_pool_size);
                 Key key = insert_pool[index];
                 // std::cout << key << std::endl;
                 global_insert_pool_set.erase(key);
@@ -469,10 +479,11 @@ void generate_workload()
 
                     delete existingPointLookupIndexGenerator;
                     existingPointLookupIndexGenerator = new Generator(existing_point_lookup_dist, 0, insert_pool.size() - 1, existing_point_lookup_norm_mean_percentile * insert_pool.size(), existing_point_lookup_norm_stddev * insert_pool.size() / scaling_ratio, existing_point_lookup_beta_alpha, existing_point_lookup_beta_beta, existing_point_lookup_zipf_alpha, insert_pool.size(), index_mapping);
+                    set_existing_point_lookup_phases(existingPointLookupIndexGenerator, total_operation_count);
                 }
 
                 // std::cout << "D " << key << std::endl;
-                fp << "D " << key << " " << std::endl;
+                fp << "D " << key << " " << '\n';
                 _point_delete_count++;
                 _effective_ingestion_count--;
                 _total_operation_count++;
@@ -493,7 +504,7 @@ void generate_workload()
                 entries_in_range_delete = 1;
             else
                 entries_in_range_delete = floor((float)range_delete_selectivity * insert_pool_size); // computed on the current size of insert pool
-            long start_index = (long)(rand() % insert_pool_size);
+            long start_index = (long)workload_random.next_below(insert_pool_size);
             long end_index = -1;
             if (start_index + entries_in_range_delete > insert_pool_size)
             {
@@ -542,7 +553,7 @@ void generate_workload()
                 // std::cout << std::endl;
 
                 // std::cout << "R " << start_key << " " << end_key << std::endl;
-                fp << "R " << start_key << " " << end_key << std::endl;
+                fp << "R " << start_key << " " << end_key << '\n';
                 _range_delete_count++;
                 _effective_ingestion_count -= entries_in_range_delete;
                 _total_operation_count++;
@@ -559,12 +570,12 @@ void generate_workload()
             }
             else
             {
-                float query_type = (float)rand() / RAND_MAX;
+                float query_type = workload_random.next_double();
                 if (query_type <= zero_result_point_lookup_proportion && _non_existing_point_query_count < non_existing_point_query_count)
                 {
                     Key key = global_non_existing_key_pool[nonExistingPointLookupIndexGenerator->getNext()];
                     // std::cout << "Q' " << key << "\t" << _non_existing_point_query_count << " < " << non_existing_point_query_count << std::endl;
-                    fp << "Q " << key << std::endl;
+                    fp << "Q " << key << '\n';
                     _point_query_count++;
                     _non_existing_point_query_count++;
                     _total_operation_count++;
@@ -595,22 +606,23 @@ void generate_workload()
                     if (existingPointLookupIndexGenerator == nullptr)
                     {
                         existingPointLookupIndexGenerator = new Generator(existing_point_lookup_dist, 0, insert_pool.size() - 1, existing_point_lookup_norm_mean_percentile * insert_pool.size(), existing_point_lookup_norm_stddev * insert_pool.size() / scaling_ratio, existing_point_lookup_beta_alpha, existing_point_lookup_beta_beta, existing_point_lookup_zipf_alpha, insert_pool.size(), index_mapping);
+                        set_existing_point_lookup_phases(existingPointLookupIndexGenerator, total_operation_count);
                     }
                     long index = 0;
                     if (existing_point_lookup_dist == 0)
                     {
-                        index = rand() % insert_pool.size();
+                        index = workload_random.next_below(insert_pool.size());
                     }
                     else
                     {
-                        index = (long)(existingPointLookupIndexGenerator->getNext());
+                        index = (long)(existingPointLookupIndexGenerator->getNextAt(_total_operation_count));
                     }
                     Key key = insert_pool[index];
                     // std::cout << key << std::endl;
 
                     // std::cout << "Q " << key << "\t" << _existing_point_query_count << " < " << existing_point_query_count << std::endl;
                     // std::cout << "Q " << key  << std::endl;
-                    fp << "Q " << key << std::endl;
+                    fp << "Q " << key << '\n';
                     _point_query_count++;
                     _existing_point_query_count++;
                     _total_operation_count++;
@@ -657,7 +669,7 @@ void generate_workload()
             // for now we use the hardcoded range selectivity
             long insert_pool_size = insert_pool.size();
             long entries_in_range_query = floor(range_query_selectivity * insert_pool_size); // computed on the current size of insert pool
-            long start_index = (long)(rand() % insert_pool_size);
+            long start_index = (long)workload_random.next_below(insert_pool_size);
             long end_index = -1;
             if (start_index + entries_in_range_query > insert_pool_size)
             {
@@ -731,7 +743,7 @@ void generate_workload()
                 // std::cout << std::endl;
 
                 // std::cout << "S " << start_key << " " << end_key << std::endl;
-                fp << "S " << start_key << " " << end_key << std::endl;
+                fp << "S " << start_key << " " << end_key << '\n';
                 _range_query_count++;
                 _total_operation_count++;
                 aggregate_progress++;
@@ -747,6 +759,362 @@ void generate_workload()
     print_workload_parameters(_insert_count, _update_count, _point_delete_count, _range_delete_count, _effective_ingestion_count);
 }
 
+// a bijection on [0, size): an invertible mix on the next power of two, applied again until the result is in range
+class IndexPermutation
+{
+    uint64_t size_;
+    uint64_t mask_;
+    int shift_;
+    uint64_t multiplier1_;
+    uint64_t multiplier2_;
+    uint64_t increment_;
+
+public:
+    IndexPermutation(uint64_t size, CounterRandom &random) : size_(size)
+    {
+        int bits = 0;
+        while (bits < 64 && (1ULL << bits) < size)
+            bits++;
+        mask_ = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        shift_ = std::max(1, bits / 2);
+        // odd multipliers are invertible modulo a power of two
+        multiplier1_ = random.next() | 1;
+        multiplier2_ = random.next() | 1;
+        increment_ = random.next();
+    }
+
+    uint64_t operator()(uint64_t index) const
+    {
+        do
+        {
+            index = (index * multiplier1_ + increment_) & mask_;
+            index ^= index >> shift_;
+            index = (index * multiplier2_) & mask_;
+        } while (index >= size_);
+        return index;
+    }
+};
+
+// writes the key of a slot, keys sort like their slots
+void encode_streaming_key(uint64_t slot, std::string &buffer)
+{
+    buffer.resize(key_size);
+    KeyCodec::EncodeText(slot * streaming_slot_stride, key_size, &buffer[0]);
+}
+
+// the op counts of a streaming workload before an op, and the position of the op type draws
+struct StreamingState
+{
+    uint64_t choice_position = 0;
+    long insert_count = 0;
+    long update_count = 0;
+    long point_query_count = 0;
+    long non_existing_point_query_count = 0;
+    long existing_point_query_count = 0;
+    long range_query_count = 0;
+};
+
+// draws the type of the next op of a streaming workload and counts it: the choice of get_choice, with 7 for zero-result
+// point queries, or 0 if the draw has to be repeated
+int next_streaming_choice(StreamingState &state, uint64_t preloaded_count, CounterRandom &random, int *flag)
+{
+    uint64_t live_count = preloaded_count + state.insert_count;
+    int choice = get_choice(random, live_count, insert_count, update_count, 0, 0, point_query_count, range_query_count, state.insert_count, state.update_count, 0, 0, state.point_query_count, state.range_query_count);
+
+    if (choice == 1)
+        state.insert_count++;
+    else if (choice == 2)
+        state.update_count++;
+    else if (choice == 5)
+    {
+        float query_type = random.next_double();
+        if (query_type <= zero_result_point_lookup_proportion && state.non_existing_point_query_count < non_existing_point_query_count)
+        {
+            state.non_existing_point_query_count++;
+            choice = 7;
+        }
+        else if (state.existing_point_query_count < existing_point_query_count)
+            state.existing_point_query_count++;
+        else // the zero-result lookups are used up, but the draw went their way
+            return 0;
+        state.point_query_count++;
+    }
+    else if (choice == 6)
+    {
+        if (floor(range_query_selectivity * live_count) == 0)
+        {
+            if (flag != nullptr)
+            {
+                std::cout << "not enough entries in tree for range query -- skipping ... ; live keys = " << live_count << std::endl;
+                if (++*flag > 20)
+                    exit(-1);
+            }
+            return 0;
+        }
+        state.range_query_count++;
+    }
+    return choice;
+}
+
+/*
+ * Generates the workload without key pools. The i-th insert writes the key of slot 2 * p(i), where p is a random
+ * permutation of the inserts, and zero-result lookups use the odd slots, so no key is ever generated twice and
+ * every key inserted so far can be found again from its insert number. Only preloaded keys, which are arbitrary,
+ * are kept in memory, along with a set of their hashes.
+ *
+ * A first pass draws the op types alone and keeps the state at the start of every segment of ops. The segments are
+ * then generated in parallel, each op from its own stream of random numbers, and written in order, so a seed gives
+ * the same workload for any number of threads.
+ *
+ * Point and range deletes are not supported. Range queries over the inserted keys span slots rather than
+ * existing keys, so their selectivity is exact only once all keys are inserted.
+ */
+void generate_workload_streaming()
+{
+    if (point_delete_count > 0 || range_delete_count > 0 || range_query_overlapping_count > 0)
+    {
+        std::cout << "\033[1;31m ERROR:\033[0m streaming does not support point deletes, range deletes or overlapping range queries" << std::endl;
+        exit(0);
+    }
+
+    long total_operation_count = insert_count + update_count + point_query_count + range_query_count;
+    std::cout << "Total operation count = " << total_operation_count << std::endl
+              << std::flush;
+
+    std::vector<std::string> preloaded_keys;
+    std::unordered_set<size_t> preloaded_key_hashes;
+    if (load_from_existing_workload)
+    {
+        std::ifstream fin(file_path + preload_filename);
+        std::string line;
+        while (getline(fin, line))
+        {
+            std::vector<std::string> splits = StringSplit(line, ' ');
+            if (splits.size() > 1 && preloaded_key_hashes.insert(std::hash<std::string>()(splits[1])).second)
+                preloaded_keys.push_back(splits[1]);
+        }
+        fin.close();
+        // lookups under the normal distribution and range queries walk the keys in key order
+        if (existing_point_lookup_dist == 1 || range_query_count > 0)
+        {
+            sort(preloaded_keys.begin(), preloaded_keys.end());
+            sorted = true;
+        }
+    }
+
+    uint64_t domain = std::max<uint64_t>(std::max(insert_count, maximum_unique_non_existing_point_query_count), 1) + STREAMING_SPARE_SLOTS;
+    uint64_t key_space = KeyCodec::TextDomain(key_size);
+    if (key_space / 2 < domain)
+    {
+        std::cout << "\033[1;31m ERROR:\033[0m too small key size to support sufficient unique keys" << std::endl;
+        exit(0);
+    }
+    streaming_slot_stride = key_space / (2 * domain);
+    IndexPermutation insert_permutation(domain, workload_random);
+    IndexPermutation non_existing_permutation(domain, workload_random);
+    double scaling_ratio = STRING_KEY_ENABLED ? (double)(std::string(Key::key_alphanum)).size() : 1.0;
+
+    // insert slots whose key collides with a preloaded key are skipped, in increasing order (almost always none)
+    std::vector<uint64_t> skipped_insert_slots;
+    if (!preloaded_key_hashes.empty())
+    {
+        std::string key_buffer;
+        for (uint64_t slot = 0, inserted = 0; inserted < (uint64_t)insert_count; slot++)
+        {
+            if (slot == domain)
+            {
+                std::cout << "\033[1;31m ERROR:\033[0m too many inserted keys collide with preloaded keys" << std::endl;
+                exit(0);
+            }
+            encode_streaming_key(2 * insert_permutation(slot), key_buffer);
+            if (preloaded_key_hashes.count(std::hash<std::string>()(key_buffer)) > 0)
+                skipped_insert_slots.push_back(slot);
+            else
+                inserted++;
+        }
+    }
+
+    // the key of the index-th live key: preloaded keys first, then the inserted ones in insert order
+    auto live_key = [&](uint64_t index, std::string &buffer) -> const std::string &
+    {
+        if (index < preloaded_keys.size())
+            return preloaded_keys[index];
+        uint64_t slot = index - preloaded_keys.size();
+        for (uint64_t skipped : skipped_insert_slots)
+            if (skipped <= slot)
+                slot++;
+        encode_streaming_key(2 * insert_permutation(slot), buffer);
+        return buffer;
+    };
+
+    // first pass: the op types, and the live key counts the generators are created with
+    std::vector<StreamingState> segment_states;
+    StreamingState state;
+    CounterRandom choice_random(seed, RANDOM_STREAM_CHOICES);
+    uint64_t update_generator_size = 0;
+    uint64_t existing_generator_size = 0;
+    int flag = 0;
+    for (long op = 0; op < total_operation_count;)
+    {
+        if (op % STREAMING_SEGMENT_SIZE == 0 && segment_states.size() == (size_t)(op / STREAMING_SEGMENT_SIZE))
+        {
+            state.choice_position = choice_random.position();
+            segment_states.push_back(state);
+        }
+        uint64_t live_count = preloaded_keys.size() + state.insert_count;
+        int choice = next_streaming_choice(state, preloaded_keys.size(), choice_random, &flag);
+        if (choice == 0)
+            continue;
+        if (choice == 2 && update_generator_size == 0)
+            update_generator_size = live_count;
+        if (choice == 5 && existing_point_lookup_dist != 0 && existing_generator_size == 0)
+            existing_generator_size = live_count;
+        op++;
+    }
+
+    if (update_generator_size > 0)
+    {
+        updateIndexGenerator = new Generator(update_dist, 0, update_generator_size - 1, update_norm_mean_percentile * update_generator_size, update_norm_stddev * update_generator_size / scaling_ratio, update_beta_alpha, update_beta_beta, update_zipf_alpha, update_generator_size);
+    }
+    if (existing_generator_size > 0)
+    {
+        existingPointLookupIndexGenerator = new Generator(existing_point_lookup_dist, 0, existing_generator_size - 1, existing_point_lookup_norm_mean_percentile * existing_generator_size, existing_point_lookup_norm_stddev * existing_generator_size / scaling_ratio, existing_point_lookup_beta_alpha, existing_point_lookup_beta_beta, existing_point_lookup_zipf_alpha, existing_generator_size);
+        set_existing_point_lookup_phases(existingPointLookupIndexGenerator, total_operation_count);
+    }
+    if (state.non_existing_point_query_count > 0)
+    {
+        uint64_t unique_count = std::max<uint64_t>(maximum_unique_non_existing_point_query_count, 1);
+        nonExistingPointLookupIndexGenerator = new Generator(non_existing_point_lookup_dist, 0, unique_count - 1, non_existing_point_lookup_norm_mean_percentile * unique_count, non_existing_point_lookup_norm_stddev * unique_count / scaling_ratio, non_existing_point_lookup_beta_alpha, non_existing_point_lookup_beta_beta, non_existing_point_lookup_zipf_alpha, unique_count);
+    }
+
+    // second pass: the ops of a segment, drawing the op types again from the segment's state
+    auto generate_segment = [&](size_t segment, std::string &out)
+    {
+        StreamingState state = segment_states[segment];
+        CounterRandom choice_random(seed, RANDOM_STREAM_CHOICES);
+        choice_random.seek(state.choice_position);
+        CounterRandom op_randoms(seed, RANDOM_STREAM_OPS);
+        std::string key_buffer;
+        std::string end_key_buffer;
+        std::string value_buffer;
+        long last_op = std::min<long>(total_operation_count, (segment + 1) * STREAMING_SEGMENT_SIZE);
+        out.clear();
+
+        for (long op = segment * STREAMING_SEGMENT_SIZE; op < last_op;)
+        {
+            uint64_t live_count = preloaded_keys.size() + state.insert_count;
+            long _insert_count = state.insert_count;
+            int choice = next_streaming_choice(state, preloaded_keys.size(), choice_random, nullptr);
+            if (choice == 0)
+                continue;
+            CounterRandom random = op_randoms.split(op);
+
+            if (choice == 1)
+            { // INSERT
+                fill_value(value_buffer, entry_size - key_size, random);
+                out += "I ";
+                out += live_key(preloaded_keys.size() + _insert_count, key_buffer);
+                out += ' ';
+                out += value_buffer;
+            }
+            else if (choice == 2)
+            { // UPDATE
+                fill_value(value_buffer, entry_size - key_size, random);
+                out += "U ";
+                out += live_key(updateIndexGenerator->getNext(random), key_buffer);
+                out += ' ';
+                out += value_buffer;
+            }
+            else if (choice == 7)
+            { // ZERO-RESULT POINT QUERY
+                uint64_t slot = non_existing_permutation(nonExistingPointLookupIndexGenerator->getNext(random));
+                encode_streaming_key(2 * slot + 1, key_buffer);
+                while (preloaded_key_hashes.count(std::hash<std::string>()(key_buffer)) > 0)
+                {
+                    slot = (slot + 1) % domain;
+                    encode_streaming_key(2 * slot + 1, key_buffer);
+                }
+                out += "Q ";
+                out += key_buffer;
+            }
+            else if (choice == 5)
+            { // POINT QUERY
+                uint64_t index = 0;
+                if (existing_point_lookup_dist == 0)
+                    index = random.next_below(live_count);
+                else
+                    index = existingPointLookupIndexGenerator->getNext(random, op);
+                out += "Q ";
+                out += live_key(index, key_buffer);
+            }
+            else if (choice == 6)
+            { // RANGE QUERY
+                long entries_in_range_query = floor(range_query_selectivity * live_count);
+                out += "S ";
+                if (_insert_count == 0)
+                {
+                    long start_index = random.next_below(preloaded_keys.size() - entries_in_range_query + 1);
+                    out += preloaded_keys[start_index];
+                    out += ' ';
+                    out += preloaded_keys[start_index + entries_in_range_query - 1];
+                }
+                else
+                {
+                    uint64_t range_slots = std::min<uint64_t>(entries_in_range_query, domain);
+                    uint64_t start_slot = random.next_below(domain - range_slots + 1);
+                    encode_streaming_key(2 * start_slot, key_buffer);
+                    encode_streaming_key(2 * (start_slot + range_slots - 1), end_key_buffer);
+                    out += key_buffer;
+                    out += ' ';
+                    out += end_key_buffer;
+                }
+            }
+            out += '\n';
+            op++;
+        }
+    };
+
+    std::vector<char> out_buffer(OUTPUT_BUFFER_SIZE);
+    std::ofstream fp;
+    fp.rdbuf()->pubsetbuf(out_buffer.data(), out_buffer.size());
+    fp.open(out_filename.compare("") == 0 ? file_path + "workload.txt" : out_filename);
+
+    std::cout << "Progress: ";
+    std::vector<std::string> segments(num_threads);
+    long progress = 0;
+    for (size_t first = 0; first < segment_states.size(); first += num_threads)
+    {
+        size_t count = std::min<size_t>(num_threads, segment_states.size() - first);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; i++)
+        {
+            threads.emplace_back(generate_segment, first + i, std::ref(segments[i]));
+        }
+        generate_segment(first, segments[0]);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            fp.write(segments[i].data(), segments[i].size());
+        }
+
+        long written = std::min<long>(total_operation_count, (first + count) * STREAMING_SEGMENT_SIZE);
+        for (; progress < written * 100 / total_operation_count; progress++)
+        {
+            std::cout << "#" << std::flush;
+        }
+    }
+
+    print_workload_parameters(state.insert_count, state.update_count, 0, 0, preloaded_keys.size() + state.insert_count);
+}
+
+void set_existing_point_lookup_phases(Generator *generator, long total_operation_count)
+{
+    generator->setPhases(existing_point_lookup_shift_period, existing_point_lookup_shift_step, existing_point_lookup_zipf_alpha_end, existing_point_lookup_zipf_alpha_period, total_operation_count);
+}
+
 void print_workload_parameters(int _insert_count, int _update_count, int _point_delete_count, int _range_delete_count, int _effective_ingestion_count)
 {
     std::cout << "Workload_parameters: "
@@ -793,12 +1161,16 @@ void print_workload_parameters(int _insert_count, int _update_count, int _point_
               << "existing_point_lookup_beta_alpha = " << existing_point_lookup_beta_alpha << ", "
               << "existing_point_lookup_beta_beta = " << existing_point_lookup_beta_beta << ", "
               << "existing_point_lookup_zipf_alpha = " << existing_point_lookup_zipf_alpha << ", "
+              << "existing_point_lookup_shift_period = " << existing_point_lookup_shift_period << ", "
+              << "existing_point_lookup_shift_step = " << existing_point_lookup_shift_step << ", "
+              << "existing_point_lookup_zipf_alpha_end = " << existing_point_lookup_zipf_alpha_end << ", "
+              << "existing_point_lookup_zipf_alpha_period = " << existing_point_lookup_zipf_alpha_period << ", "
               << "sorted = " << sorted << ", "
               << "num_insert_key_prefix = " << num_insert_key_prefix
               << std::endl;
 }
 
-int get_choice(long insert_pool_size, long insert_count, long update_count, long point_delete_count, long range_delete_count, long point_query_count, long range_query_count, long _insert_count, long _update_count, long _point_delete_count, long _range_delete_count, long _point_query_count, long _range_query_count)
+int get_choice(CounterRandom &random, long insert_pool_size, long insert_count, long update_count, long point_delete_count, long range_delete_count, long point_query_count, long range_query_count, long _insert_count, long _update_count, long _point_delete_count, long _range_delete_count, long _point_query_count, long _range_query_count)
 {
     long total_operation_count = (insert_count - _insert_count) + (update_count - _update_count) + (point_delete_count - _point_delete_count) + (range_delete_count - _range_delete_count) + (point_query_count - _point_query_count) + (range_query_count - _range_query_count);
     if (total_operation_count == 0)
@@ -813,7 +1185,7 @@ int get_choice(long insert_pool_size, long insert_count, long update_count, long
     int choice_domain = 6;
     int choice = 0;
 
-    float rand_float = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX));
+    float rand_float = random.next_double();
     // std::cout << cumulative_fraction << " " << rand_float << std::endl;
 
     if (rand_float < insert_fraction)
@@ -914,7 +1286,15 @@ int main(int argc, char *argv[])
         exit(0);
     }*/
 
-    generate_workload();
+    // printed so that the workload can be generated again
+    std::cout << "Seed = " << seed << std::endl;
+    workload_random = CounterRandom(seed, RANDOM_STREAM_WORKLOAD);
+    Generator::seed = CounterRandom(seed, RANDOM_STREAM_GENERATORS).next();
+
+    if (streaming)
+        generate_workload_streaming();
+    else
+        generate_workload();
 
     /*
     if (lambda == -1) { // this means, the size of the key is equal to the size of uint32_t, i.e., 4 bytes
@@ -973,9 +1353,12 @@ int parse_arguments2(int argc, char *argv[])
     args::ValueFlag<uint32_t> entry_size_cmd(group1, "E", "Entry size (in bytes) [def: 8]", {'E', "entry_size"});
     args::ValueFlag<float> lambda_cmd(group1, "L", "lambda = key_size / (key_size + value_size) [def: 0.5]", {'L', "lambda"});
 
-    args::Flag load_from_existing_workload_cmd(group1, "Preload", "preload from workload", {"PL", "preloading"});
+    args::Flag load_from_existing_workload_cmd(group1, "Preload", "preload from workload, whose keys must be written by this generator with the same key size", {"PL", "preloading"});
     args::ValueFlag<std::string> preload_filename_cmd(group1, "PLF", "preload filename", {"PLF", "preload-filename"});
     args::ValueFlag<std::string> out_filename_cmd(group1, "OP", "output path [def: 0]", {"OP", "output-path"});
+    args::Flag streaming_cmd(group1, "Streaming", "derive keys from their index instead of keeping key pools, in bounded memory (no deletes)", {"ST", "streaming"});
+    args::ValueFlag<uint64_t> seed_cmd(group1, "seed", "Seed of the random numbers, the same seed and arguments give the same workload [def: from the clock]", {"seed"});
+    args::ValueFlag<int> threads_cmd(group1, "T", "Threads generating a streaming workload, which does not change it [def: number of cores]", {'T', "threads"});
     // distribution params
     args::ValueFlag<uint32_t> insert_dist_cmd(group1, "ID", "Insert Distribution [0: uniform, 1:normal, 2:beta, 3:zipf, def: 0]", {"ID", "insert_distribution"});
     args::ValueFlag<float> insert_dist_norm_mean_percentile_cmd(group1, "ID_Norm_Mean_Percentile", ", def: 0.5]", {"ID_NMP", "insert_distribution_norm_mean_percentile"});
@@ -997,6 +1380,10 @@ int parse_arguments2(int argc, char *argv[])
     args::ValueFlag<float> existing_point_lookup_dist_beta_alpha_cmd(group1, "ED_Beta_Alpha", ", def: 1.0]", {"ED_BALPHA", "existing_point_lookup_distribution_beta_alpha"});
     args::ValueFlag<float> existing_point_lookup_dist_beta_beta_cmd(group1, "ED_Beta_Beta", ", def: 1.0]", {"ED_BBETA", "existing_point_lookup_distribution_beta_beta"});
     args::ValueFlag<float> existing_point_lookup_dist_zipf_alpha_cmd(group1, "ED_Zipf_Alpha", ", def: 1.0]", {"ED_ZALPHA", "existing_point_lookup_distribution_zipf_alpha"});
+    args::ValueFlag<long> existing_point_lookup_shift_cmd(group1, "ED_Shift", "Ops between moves of the hot set of existing point lookups, 0 keeps it in place [def: 0]", {"ED_SHIFT", "existing_point_lookup_shift_period"});
+    args::ValueFlag<float> existing_point_lookup_shift_step_cmd(group1, "ED_Shift_Step", "Fraction of the keys the hot set moves by, 0 jumps to a random place [def: 0]", {"ED_SHIFT_STEP", "existing_point_lookup_shift_step"});
+    args::ValueFlag<float> existing_point_lookup_dist_zipf_alpha_end_cmd(group1, "ED_Zipf_Alpha_End", "Zipf alpha the lookups move to over the workload [def: ED_ZALPHA]", {"ED_ZALPHA_END", "existing_point_lookup_distribution_zipf_alpha_end"});
+    args::ValueFlag<long> existing_point_lookup_dist_zipf_alpha_period_cmd(group1, "ED_Zipf_Alpha_Period", "Ops of a cycle from ED_ZALPHA to ED_ZALPHA_END and back, 0 moves linearly once [def: 0]", {"ED_ZALPHA_PERIOD", "existing_point_lookup_distribution_zipf_alpha_period"});
 
     args::ValueFlag<uint32_t> non_existing_point_lookup_dist_cmd(group1, "ZD", "Zero-result Point Lookup Distribution [0: uniform, 1:normal, 2:beta, 3:zipf, def: 0]", {"ZD", "non_existing_point_lookup_distribution"});
     args::ValueFlag<float> non_existing_point_lookup_dist_norm_mean_percentile_cmd(group1, "ZD_Norm_Mean_Percentile", ", def: 0.5]", {"ZD_NMP", "non_existing_point_lookup_distribution_norm_mean_percentile"});
@@ -1071,10 +1458,24 @@ int parse_arguments2(int argc, char *argv[])
     {
         key_size = lambda * entry_size;
     }
+    if (key_size < STRING_PREFIX_DIGITS)
+    {
+        std::cerr << "\033[0;31m ERROR:\033[0m The key size should be at least " << STRING_PREFIX_DIGITS << " bytes" << std::endl;
+        return 1;
+    }
+    Key::width = key_size;
 
     load_from_existing_workload = load_from_existing_workload_cmd ? true : false;
     preload_filename = preload_filename_cmd ? args::get(preload_filename_cmd) : "";
     out_filename = out_filename_cmd ? args::get(out_filename_cmd) : "";
+    streaming = streaming_cmd ? true : false;
+    seed = seed_cmd ? args::get(seed_cmd) : std::chrono::system_clock::now().time_since_epoch().count();
+    num_threads = threads_cmd ? args::get(threads_cmd) : std::max<int>(std::thread::hardware_concurrency(), 1);
+    if (num_threads < 1)
+    {
+        std::cerr << "\033[0;31m ERROR:\033[0m The number of threads should be at least 1" << std::endl;
+        return 1;
+    }
 
     // distribution
     insert_dist = insert_dist_cmd ? args::get(insert_dist_cmd) : 0;
@@ -1104,6 +1505,15 @@ int parse_arguments2(int argc, char *argv[])
     existing_point_lookup_beta_alpha = existing_point_lookup_dist_beta_alpha_cmd ? args::get(existing_point_lookup_dist_beta_alpha_cmd) : 1.0;
     existing_point_lookup_beta_beta = existing_point_lookup_dist_beta_beta_cmd ? args::get(existing_point_lookup_dist_beta_beta_cmd) : 1.0;
     existing_point_lookup_zipf_alpha = existing_point_lookup_dist_zipf_alpha_cmd ? args::get(existing_point_lookup_dist_zipf_alpha_cmd) : 1.0;
+    existing_point_lookup_shift_period = existing_point_lookup_shift_cmd ? args::get(existing_point_lookup_shift_cmd) : 0;
+    existing_point_lookup_shift_step = existing_point_lookup_shift_step_cmd ? args::get(existing_point_lookup_shift_step_cmd) : 0;
+    existing_point_lookup_zipf_alpha_end = existing_point_lookup_dist_zipf_alpha_end_cmd ? args::get(existing_point_lookup_dist_zipf_alpha_end_cmd) : existing_point_lookup_zipf_alpha;
+    existing_point_lookup_zipf_alpha_period = existing_point_lookup_dist_zipf_alpha_period_cmd ? args::get(existing_point_lookup_dist_zipf_alpha_period_cmd) : 0;
+    if (existing_point_lookup_shift_period < 0 || existing_point_lookup_zipf_alpha_period < 0 || existing_point_lookup_shift_step < 0 || existing_point_lookup_shift_step > 1)
+    {
+        std::cerr << "\033[0;31m ERROR:\033[0m The shift and alpha periods should not be negative, and the shift step should be set between 0 and 1" << std::endl;
+        return 1;
+    }
 
     if (insert_norm_mean_percentile <= 0 || insert_norm_mean_percentile > 1 || update_norm_mean_percentile <= 0 || update_norm_mean_percentile > 1 ||
         non_existing_point_lookup_norm_mean_percentile <= 0 || non_existing_point_lookup_norm_mean_percentile > 1 ||
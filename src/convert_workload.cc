@@ -0,0 +1,76 @@
+#include <args.hxx>
+#include <KeyCodec.h>
+#include <workload_file.h>
+
+#include <iostream>
+#include <string>
+
+/** Re-encodes a text key of load_gen as a big-endian binary key of the given width, false if it does not fit */
+bool ToBinaryKey(const rocksdb::Slice& key, const int width, std::string& buffer) {
+  uint64_t value;
+  if (!KeyCodec::DecodeText(key.data(), key.size(), &value))
+    return false;
+  const uint64_t domain = KeyCodec::BinaryDomain(width);
+  if (domain != 0 && value >= domain)
+    return false;
+  buffer.resize(width);
+  KeyCodec::EncodeBinary(value, width, buffer.data());
+  return true;
+}
+
+/** Converts a text workload (as emitted by load_gen) into the binary workload format. */
+int main(int argc, char *argv[]) {
+  args::ArgumentParser parser("Converts a text workload into the binary workload format.", "");
+  args::Group group(parser, "This group is all exclusive: ", args::Group::Validators::DontCare);
+
+  args::ValueFlag<std::string> workload_file(group, "workload", "The text workload to convert [default: workload.txt]",
+    {'w', "workload"});
+  args::ValueFlag<std::string> output_file(group, "output", "The binary workload to write [default: workload.bin]",
+    {'o', "output"});
+  args::ValueFlag<int> binary_keys(group, "width",
+    "Re-encode the keys as fixed-width big-endian binary keys of this many bytes, in the same order (0 keeps the text "
+    "keys) [default: 0]", {'k', "binary_keys"});
+
+  parser.ParseCLI(argc, argv);
+
+  const std::string input_path = workload_file ? get(workload_file) : "workload.txt";
+  const std::string output_path = output_file ? get(output_file) : "workload.bin";
+  const int key_width = binary_keys ? get(binary_keys) : 0;
+  if (key_width < 0) {
+    std::cerr << "ERROR: The key width cannot be negative" << std::endl;
+    return 1;
+  }
+
+  TextWorkloadReader reader(input_path);
+  BinaryWorkloadWriter writer(output_path, key_width);
+
+  WorkloadOp op;
+  std::string key_buffer;
+  std::string end_key_buffer;
+  uint64_t line_num = 1;
+  while (reader.Next(op)) {
+    if (!WorkloadFormat::IsKnownInstruction(op.instruction)) {
+      std::cerr << "ERROR: Unknown workload instruction. Workload line: " << line_num << std::endl;
+      return 1;
+    }
+
+    if (key_width > 0) {
+      const bool has_end_key = op.instruction == 'S' || op.instruction == 'R';
+      if (!ToBinaryKey(op.key, key_width, key_buffer) || (has_end_key && !ToBinaryKey(op.end_key, key_width, end_key_buffer))) {
+        std::cerr << "ERROR: Key does not fit in " << key_width << " bytes. Workload line: " << line_num << std::endl;
+        return 1;
+      }
+      op.key = key_buffer;
+      if (has_end_key)
+        op.end_key = end_key_buffer;
+    }
+
+    writer.Add(op);
+    line_num++;
+  }
+  writer.Finish();
+
+  std::cout << "Converted " << writer.NumOps() << " instructions to " << output_path << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <args.hxx>
+#include <trace_file.h>
+#include <workload_file.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/** Converts a RocksDB query trace or block cache trace into the binary workload format. */
+int main(int argc, char *argv[]) {
+  args::ArgumentParser parser("Converts a RocksDB query trace or block cache trace into the binary workload format.", "");
+  args::Group group(parser, "This group is all exclusive: ", args::Group::Validators::DontCare);
+
+  args::ValueFlag<std::string> trace_file(group, "trace", "The query trace to import, as written by DB::StartTrace",
+    {'t', "trace"});
+  args::ValueFlag<std::string> block_cache_trace_file(group, "block_cache_trace",
+    "The block cache trace to import, as written by DB::StartBlockCacheTrace", {'b', "block_cache_trace"});
+  args::ValueFlag<std::string> output_file(group, "output", "The binary workload to write [default: workload.bin]",
+    {'o', "output"});
+  args::ValueFlag<int> timing(group, "timing",
+    "Keep the time of every op, so --replay_speed can replay the trace at its original pace [default: 1]",
+    {"timing"});
+
+  parser.ParseCLI(argc, argv);
+
+  if (!trace_file == !block_cache_trace_file) {
+    std::cerr << "ERROR: Give either a query trace (-t) or a block cache trace (-b)" << std::endl;
+    return 1;
+  }
+  const std::string output_path = output_file ? get(output_file) : "workload.bin";
+  const bool keep_timing = timing ? get(timing) != 0 : true;
+
+  std::unique_ptr<TraceWorkloadReader> reader;
+  if (trace_file)
+    reader = std::make_unique<QueryTraceWorkloadReader>(get(trace_file));
+  else
+    reader = std::make_unique<BlockCacheTraceWorkloadReader>(get(block_cache_trace_file));
+  BinaryWorkloadWriter writer(output_path, 0, keep_timing);
+
+  WorkloadOp op;
+  uint64_t duration_micros = 0;
+  while (reader->Next(op)) {
+    writer.Add(op);
+    duration_micros = std::max(duration_micros, op.timestamp);
+  }
+  writer.Finish();
+
+  const TraceImportStats& stats = reader->Stats();
+  std::cout << "Imported " << writer.NumOps() << " instructions from " << stats.records << " trace records to "
+    << output_path;
+  if (keep_timing)
+    std::cout << ", spanning " << duration_micros / 1e6 << " s";
+  std::cout << std::endl;
+  if (stats.skipped_seeks > 0)
+    std::cout << "Skipped " << stats.skipped_seeks << " seeks without an upper bound or in reverse" << std::endl;
+  if (stats.skipped_merges > 0)
+    std::cout << "Skipped " << stats.skipped_merges << " merges" << std::endl;
+  if (stats.skipped_block_lookups > 0)
+    std::cout << "Skipped " << stats.skipped_block_lookups << " block lookups of iterators and background jobs"
+      << std::endl;
+  if (stats.skipped_empty_keys > 0)
+    std::cout << "Skipped " << stats.skipped_empty_keys << " block lookups without a referenced key" << std::endl;
+  if (stats.skipped_other > 0)
+    std::cout << "Skipped " << stats.skipped_other << " other records" << std::endl;
+
+  return 0;
+}
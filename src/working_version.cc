@@ -1,3 +1,4 @@
+#include <bulk_load.h>
 #include <parse_arguments.h>
 #include <run_workload.h>
 #include <db_env.h>
@@ -6,7 +7,10 @@ int main(int argc, char *argv[]) {
   DBEnv env;
 
   ParseArguments(argc, argv, env);
-  RunWorkload(env);
+  if (env.bulk_load)
+    BulkLoadWorkload(env);
+  else
+    RunWorkload(env);
 
   return 0;
 }